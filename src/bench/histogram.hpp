@@ -0,0 +1,227 @@
+#ifndef HISTOGRAM_HPP
+#define HISTOGRAM_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace bench {
+  /**
+   * A latency histogram with the layout of HdrHistogram: values are kept in buckets of
+   * doubling size, each split into the same number of linear sub-buckets, so every recorded
+   * value is reproduced to the given number of significant digits across the whole range
+   * while recording stays a couple of shifts and an increment.
+   */
+  class Histogram {
+    protected:
+      int64_t highest;
+      int sub_bucket_half_count_magnitude;
+      int64_t sub_bucket_count;
+      int64_t sub_bucket_half_count;
+      int64_t sub_bucket_mask;
+      int bucket_count;
+
+      /**
+       * The counts of all sub-buckets, the lower half of every bucket but the first
+       * overlaps the one before it and is left out
+       */
+      std::vector<uint64_t> counts;
+
+      uint64_t total;
+      int64_t min_value;
+      int64_t max_value;
+
+      int bucketIndex(int64_t value) const {
+        int pow2ceiling = 64 - __builtin_clzll(value | sub_bucket_mask);
+        return pow2ceiling - (sub_bucket_half_count_magnitude + 1);
+      }
+
+      size_t countsIndex(int64_t value) const {
+        int bucket = bucketIndex(value);
+        int64_t sub_bucket = value >> bucket;
+        return ((int64_t)(bucket + 1) << sub_bucket_half_count_magnitude) + sub_bucket - sub_bucket_half_count;
+      }
+
+      int64_t valueAt(size_t index) const {
+        int bucket = (int)(index >> sub_bucket_half_count_magnitude) - 1;
+        int64_t sub_bucket = (index & (sub_bucket_half_count - 1)) + sub_bucket_half_count;
+
+        if (bucket < 0) {
+          sub_bucket -= sub_bucket_half_count;
+          bucket = 0;
+        }
+
+        return sub_bucket << bucket;
+      }
+
+      /**
+       * Returns the largest value that falls into the same sub-bucket as the given one
+       */
+      int64_t highestEquivalent(int64_t value) const {
+        int bucket = bucketIndex(value);
+        int64_t sub_bucket = value >> bucket;
+        int adjusted = sub_bucket >= sub_bucket_count ? bucket + 1 : bucket;
+        return (sub_bucket << bucket) + ((int64_t)1 << adjusted) - 1;
+      }
+
+    public:
+      /**
+       * Creates an empty histogram
+       * @param highest the largest value that can be recorded, larger ones are clamped
+       * @param digits the number of significant digits kept, between 1 and 5
+       */
+      Histogram(int64_t h = 3600LL * 1000 * 1000, int digits = 3) : highest(h), sub_bucket_half_count_magnitude(0),
+        sub_bucket_count(0), sub_bucket_half_count(0), sub_bucket_mask(0), bucket_count(1), counts(), total(0),
+        min_value(INT64_MAX), max_value(0) {
+        int64_t largest_single_unit = 2 * (int64_t)pow(10, digits);
+        int sub_bucket_count_magnitude = (int)ceil(log2((double)largest_single_unit));
+
+        sub_bucket_half_count_magnitude = (sub_bucket_count_magnitude > 1 ? sub_bucket_count_magnitude : 1) - 1;
+        sub_bucket_count = (int64_t)1 << (sub_bucket_half_count_magnitude + 1);
+        sub_bucket_half_count = sub_bucket_count / 2;
+        sub_bucket_mask = sub_bucket_count - 1;
+
+        int64_t smallest_untrackable = sub_bucket_count;
+
+        while (smallest_untrackable <= highest) {
+          smallest_untrackable <<= 1;
+          bucket_count++;
+        }
+
+        counts.assign((bucket_count + 1) * sub_bucket_half_count, 0);
+      }
+
+      /**
+       * Records a value
+       * @param value the value, negative ones are recorded as 0
+       * @param count the number of times to record it
+       */
+      void record(int64_t value, uint64_t count = 1) {
+        if (value < 0) {
+          value = 0;
+        } else if (value > highest) {
+          value = highest;
+        }
+
+        counts[countsIndex(value)] += count;
+        total += count;
+
+        if (value < min_value) {
+          min_value = value;
+        }
+
+        if (value > max_value) {
+          max_value = value;
+        }
+      }
+
+      /**
+       * Records a value measured by a closed-loop client that meant to send a request every
+       * interval. A response that took longer held back the requests that should have gone
+       * out in the meantime, so these are recorded with the latency they would have seen.
+       * @param value the value
+       * @param interval the expected interval between requests, 0 to record the value as it is
+       */
+      void recordCorrected(int64_t value, int64_t interval) {
+        record(value);
+
+        if (interval <= 0) {
+          return;
+        }
+
+        for (int64_t missed = value - interval; missed >= interval; missed -= interval) {
+          record(missed);
+        }
+      }
+
+      /**
+       * Adds the values of another histogram with the same layout
+       * @param other the histogram to add
+       */
+      void add(const Histogram& other) {
+        for (size_t i = 0; i < counts.size() && i < other.counts.size(); i++) {
+          counts[i] += other.counts[i];
+        }
+
+        total += other.total;
+
+        if (other.min_value < min_value) {
+          min_value = other.min_value;
+        }
+
+        if (other.max_value > max_value) {
+          max_value = other.max_value;
+        }
+      }
+
+      /**
+       * Returns the value below which the given percentage of values fall
+       * @param percentile the percentage, between 0 and 100
+       * @return the value, 0 if the histogram is empty
+       */
+      int64_t percentile(double percentile) const {
+        uint64_t wanted = (uint64_t)(percentile / 100.0 * total + 0.5);
+        uint64_t seen = 0;
+
+        if (wanted < 1) {
+          wanted = 1;
+        }
+
+        for (size_t i = 0; i < counts.size(); i++) {
+          seen += counts[i];
+
+          if (seen >= wanted) {
+            int64_t value = highestEquivalent(valueAt(i));
+            return value < max_value ? value : max_value;
+          }
+        }
+
+        return 0;
+      }
+
+      /**
+       * Returns the mean of the recorded values
+       */
+      double mean() const {
+        double sum = 0;
+
+        for (size_t i = 0; i < counts.size(); i++) {
+          if (counts[i]) {
+            sum += (double)counts[i] * valueAt(i);
+          }
+        }
+
+        return total ? sum / total : 0;
+      }
+
+      /**
+       * Returns the standard deviation of the recorded values
+       */
+      double stddev() const {
+        double m = mean();
+        double sum = 0;
+
+        for (size_t i = 0; i < counts.size(); i++) {
+          if (counts[i]) {
+            double d = valueAt(i) - m;
+            sum += (double)counts[i] * d * d;
+          }
+        }
+
+        return total ? sqrt(sum / total) : 0;
+      }
+
+      uint64_t count() const {
+        return total;
+      }
+
+      int64_t min() const {
+        return total ? min_value : 0;
+      }
+
+      int64_t max() const {
+        return max_value;
+      }
+  };
+};
+#endif
@@ -0,0 +1,701 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+
+#include <unistd.h>
+#include <strings.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include <event2/event.h>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/util.h>
+
+#include <bench/histogram.hpp>
+
+/**
+ * A load generator for salthttpd. Every thread runs its own event loop with a share of the
+ * connections, which either keep a number of requests in flight (closed loop) or send them
+ * on a fixed schedule (open loop). In open-loop mode latencies are measured from the moment
+ * a request was due rather than from the moment it could be sent, so a stalled server shows
+ * up in the percentiles instead of silently lowering the request rate. Results are printed
+ * as JSON so runs can be compared.
+ */
+
+static const char* USAGE =
+  "usage: salthttpd-bench [options] [path...]\n"
+  "  -u host:port  the server to load (127.0.0.1:5555)\n"
+  "  -t threads    number of client threads (1)\n"
+  "  -c conns      number of active connections (16)\n"
+  "  -I conns      number of additional idle connections (0)\n"
+  "  -d seconds    duration of the measurement (10)\n"
+  "  -W seconds    warmup before the measurement (1)\n"
+  "  -r rate       requests per second over all connections, 0 for a closed loop (0)\n"
+  "  -P depth      requests pipelined on a connection (1)\n"
+  "  -i usec       expected interval between requests of a closed-loop connection,\n"
+  "                enables coordinated omission correction (0)\n"
+  "  -k            close the connection after every request\n"
+  "  -H header     add a request header, may be repeated\n"
+  "  -f file       read the paths to request from a file, one per line\n"
+  "  -l label      a label copied into the results\n";
+
+typedef std::chrono::steady_clock::time_point::rep nanos;
+
+static nanos now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * The settings shared by all threads
+ */
+struct Settings {
+  struct sockaddr_storage addr;
+  int addr_len;
+  int threads;
+  int connections;
+  int idle;
+  int duration;
+  int warmup;
+  double rate;
+  int depth;
+  int64_t interval;
+  bool keep_alive;
+  std::vector<std::string> requests;
+  std::string label;
+  std::string target;
+};
+
+/**
+ * What a thread measured
+ */
+struct Counters {
+  uint64_t requests;
+  uint64_t bytes;
+  uint64_t status[6];
+  uint64_t connect_errors;
+  uint64_t read_errors;
+  uint64_t parse_errors;
+  uint64_t lost;
+  uint64_t idle_closed;
+};
+
+struct Worker;
+
+/**
+ * A client connection and the state of its response parser
+ */
+struct Connection {
+  enum class State { STATUS, HEADERS, BODY, CHUNK_SIZE, CHUNK_DATA, CHUNK_END, TRAILERS, UNTIL_CLOSE };
+
+  Worker* worker;
+  int index;
+  bool idle;
+  struct bufferevent* bev;
+  struct event* timer;
+  bool connected;
+
+  /**
+   * The moments the outstanding requests were due, oldest first
+   */
+  std::deque<nanos> due;
+
+  /**
+   * When the next request is due in open-loop mode
+   */
+  nanos next_due;
+
+  size_t next_request;
+  uint64_t sent_on_connection;
+
+  State state;
+  int status;
+  int64_t remaining;
+  bool chunked;
+  bool close_after;
+};
+
+struct Worker {
+  const Settings* settings;
+  struct event_base* base;
+  std::vector<Connection*> connections;
+  nanos measure_start;
+  nanos interval;
+  bench::Histogram latency;
+  Counters counters;
+};
+
+static void open_connection(Connection* conn);
+static void pump(Connection* conn);
+
+static void reconnect_cb(evutil_socket_t, short, void* arg) {
+  open_connection(static_cast<Connection*>(arg));
+}
+
+/**
+ * Drops the connection and opens a new one, after a pause if the server is unreachable
+ */
+static void reset(Connection* conn, bool backoff) {
+  Worker* worker = conn->worker;
+
+  bufferevent_free(conn->bev);
+  conn->bev = NULL;
+  conn->connected = false;
+
+  if (!conn->due.empty()) {
+    if (now() >= worker->measure_start) {
+      worker->counters.lost += conn->due.size();
+    }
+
+    conn->due.clear();
+  }
+
+  if (conn->idle) {
+    return;
+  }
+
+  struct timeval delay = { 0, backoff ? 10000 : 0 };
+  event_base_once(worker->base, -1, EV_TIMEOUT, reconnect_cb, conn, &delay);
+}
+
+/**
+ * Sends the next request, which was due at the given time
+ */
+static void send_request(Connection* conn, nanos due) {
+  const std::vector<std::string>& requests = conn->worker->settings->requests;
+  const std::string& request = requests[conn->next_request++ % requests.size()];
+
+  bufferevent_write(conn->bev, request.data(), request.size());
+  conn->due.push_back(due);
+  conn->sent_on_connection++;
+}
+
+/**
+ * Sends as many requests as the mode allows
+ */
+static void pump(Connection* conn) {
+  Worker* worker = conn->worker;
+  const Settings* settings = worker->settings;
+  size_t depth = settings->keep_alive ? settings->depth : 1;
+
+  if (!conn->bev || (!settings->keep_alive && conn->sent_on_connection > 0)) {
+    return;
+  }
+
+  if (settings->rate <= 0) {
+    while (conn->due.size() < depth) {
+      send_request(conn, now());
+    }
+    return;
+  }
+
+  // requests that fell behind schedule keep the time they were due
+  nanos t = now();
+
+  while (conn->due.size() < depth && conn->next_due <= t) {
+    send_request(conn, conn->next_due);
+    conn->next_due += worker->interval;
+
+    if (!settings->keep_alive) {
+      break;
+    }
+  }
+
+  if (conn->due.size() < depth && conn->next_due > t) {
+    nanos wait = conn->next_due - t;
+    struct timeval tv = { (time_t)(wait / 1000000000), (suseconds_t)(wait % 1000000000 / 1000) };
+    evtimer_add(conn->timer, &tv);
+  }
+}
+
+static void timer_cb(evutil_socket_t, short, void* arg) {
+  pump(static_cast<Connection*>(arg));
+}
+
+/**
+ * Accounts for a complete response
+ * @return false if the connection has to be reopened
+ */
+static bool complete(Connection* conn) {
+  Worker* worker = conn->worker;
+  nanos t = now();
+
+  if (!conn->due.empty()) {
+    if (t >= worker->measure_start) {
+      worker->latency.recordCorrected((t - conn->due.front()) / 1000, worker->settings->interval);
+      worker->counters.requests++;
+      worker->counters.status[conn->status / 100 < 6 ? conn->status / 100 : 0]++;
+    }
+
+    conn->due.pop_front();
+  }
+
+  conn->state = Connection::State::STATUS;
+
+  return !conn->close_after;
+}
+
+/**
+ * Reads a CRLF terminated line and hands it to the given function
+ * @return false if no complete line is buffered yet
+ */
+template<typename F> static bool line(struct evbuffer* in, F f) {
+  size_t n;
+  char* l = evbuffer_readln(in, &n, EVBUFFER_EOL_CRLF);
+
+  if (!l) {
+    return false;
+  }
+
+  f(l, n);
+  free(l);
+
+  return true;
+}
+
+/**
+ * Consumes the buffered responses
+ * @return false if the connection has to be reopened
+ */
+static bool parse(Connection* conn, struct evbuffer* in) {
+  bool ok = true;
+
+  while (ok) {
+    switch (conn->state) {
+      case Connection::State::STATUS:
+        if (!line(in, [conn, &ok](char* l, size_t) {
+          int major, minor;
+
+          if (sscanf(l, "HTTP/%d.%d %d", &major, &minor, &conn->status) != 3) {
+            ok = false;
+            return;
+          }
+
+          conn->close_after = major == 1 && minor == 0;
+          conn->remaining = -1;
+          conn->chunked = false;
+          conn->state = Connection::State::HEADERS;
+        })) {
+          return true;
+        }
+
+        if (!ok) {
+          conn->worker->counters.parse_errors++;
+          return false;
+        }
+        break;
+
+      case Connection::State::HEADERS:
+        if (!line(in, [conn, &ok](char* l, size_t n) {
+          if (n > 0) {
+            if (!strncasecmp(l, "Content-Length:", 15)) {
+              conn->remaining = strtoll(l + 15, NULL, 10);
+            } else if (!strncasecmp(l, "Transfer-Encoding:", 18)) {
+              conn->chunked = strcasestr(l + 18, "chunked") != NULL;
+            } else if (!strncasecmp(l, "Connection:", 11)) {
+              conn->close_after = strcasestr(l + 11, "close") != NULL;
+            }
+            return;
+          }
+
+          if (conn->status < 200 || conn->status == 204 || conn->status == 304) {
+            ok = complete(conn);
+          } else if (conn->chunked) {
+            conn->state = Connection::State::CHUNK_SIZE;
+          } else if (conn->remaining == 0) {
+            ok = complete(conn);
+          } else if (conn->remaining > 0) {
+            conn->state = Connection::State::BODY;
+          } else {
+            conn->state = Connection::State::UNTIL_CLOSE;
+          }
+        })) {
+          return true;
+        }
+        break;
+
+      case Connection::State::BODY:
+      case Connection::State::CHUNK_DATA: {
+        int64_t available = evbuffer_get_length(in);
+        int64_t n = available < conn->remaining ? available : conn->remaining;
+
+        evbuffer_drain(in, n);
+        conn->remaining -= n;
+
+        if (conn->remaining > 0) {
+          return true;
+        }
+
+        if (conn->state == Connection::State::CHUNK_DATA) {
+          conn->state = Connection::State::CHUNK_END;
+        } else {
+          ok = complete(conn);
+        }
+        break;
+      }
+
+      case Connection::State::CHUNK_SIZE:
+        if (!line(in, [conn](char* l, size_t) {
+          conn->remaining = strtoll(l, NULL, 16);
+          conn->state = conn->remaining > 0 ? Connection::State::CHUNK_DATA : Connection::State::TRAILERS;
+        })) {
+          return true;
+        }
+        break;
+
+      case Connection::State::CHUNK_END:
+        if (!line(in, [conn](char*, size_t) {
+          conn->state = Connection::State::CHUNK_SIZE;
+        })) {
+          return true;
+        }
+        break;
+
+      case Connection::State::TRAILERS:
+        if (!line(in, [conn, &ok](char*, size_t n) {
+          if (n == 0) {
+            ok = complete(conn);
+          }
+        })) {
+          return true;
+        }
+        break;
+
+      case Connection::State::UNTIL_CLOSE:
+        evbuffer_drain(in, evbuffer_get_length(in));
+        return true;
+    }
+  }
+
+  return false;
+}
+
+static void read_cb(struct bufferevent* bev, void* arg) {
+  Connection* conn = static_cast<Connection*>(arg);
+  Worker* worker = conn->worker;
+  struct evbuffer* in = bufferevent_get_input(bev);
+  size_t before = evbuffer_get_length(in);
+
+  if (conn->idle) {
+    evbuffer_drain(in, before);
+    return;
+  }
+
+  bool ok = parse(conn, in);
+
+  if (now() >= worker->measure_start) {
+    worker->counters.bytes += before - evbuffer_get_length(in);
+  }
+
+  if (ok) {
+    pump(conn);
+  } else {
+    reset(conn, false);
+  }
+}
+
+static void event_cb(struct bufferevent* bev, short what, void* arg) {
+  Connection* conn = static_cast<Connection*>(arg);
+  Worker* worker = conn->worker;
+
+  if (what & BEV_EVENT_CONNECTED) {
+    int one = 1;
+    setsockopt(bufferevent_getfd(bev), IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    conn->connected = true;
+    return;
+  }
+
+  if (conn->idle) {
+    worker->counters.idle_closed++;
+    reset(conn, false);
+    return;
+  }
+
+  if (!conn->connected) {
+    worker->counters.connect_errors++;
+    reset(conn, true);
+    return;
+  }
+
+  // a response without a length ends with the connection
+  if (conn->state == Connection::State::UNTIL_CLOSE) {
+    complete(conn);
+  } else if (!conn->due.empty() && now() >= worker->measure_start) {
+    worker->counters.read_errors++;
+  }
+
+  reset(conn, false);
+}
+
+static void open_connection(Connection* conn) {
+  Worker* worker = conn->worker;
+  const Settings* settings = worker->settings;
+
+  conn->bev = bufferevent_socket_new(worker->base, -1, BEV_OPT_CLOSE_ON_FREE);
+  conn->state = Connection::State::STATUS;
+  conn->sent_on_connection = 0;
+
+  bufferevent_setcb(conn->bev, read_cb, NULL, event_cb, conn);
+  bufferevent_enable(conn->bev, EV_READ | EV_WRITE);
+
+  if (bufferevent_socket_connect(conn->bev, (struct sockaddr*)&settings->addr, settings->addr_len) < 0) {
+    worker->counters.connect_errors++;
+    reset(conn, true);
+    return;
+  }
+
+  // requests are buffered until the connection is established
+  if (!conn->idle) {
+    pump(conn);
+  }
+}
+
+static void stop_cb(evutil_socket_t, short, void* arg) {
+  event_base_loopexit(static_cast<Worker*>(arg)->base, NULL);
+}
+
+static void run(Worker* worker) {
+  const Settings* settings = worker->settings;
+  nanos start = now();
+
+  worker->measure_start = start + (nanos)settings->warmup * 1000000000;
+
+  // spread the first requests of the connections over one interval
+  for (size_t i = 0; i < worker->connections.size(); i++) {
+    Connection* conn = worker->connections[i];
+    conn->next_due = start + worker->interval * (nanos)i / (nanos)worker->connections.size();
+    conn->timer = evtimer_new(worker->base, timer_cb, conn);
+    open_connection(conn);
+  }
+
+  struct timeval end = { settings->warmup + settings->duration, 0 };
+  event_base_once(worker->base, -1, EV_TIMEOUT, stop_cb, worker, &end);
+  event_base_dispatch(worker->base);
+
+  // idle connections still marked connected survived the run
+  for (Connection* conn : worker->connections) {
+    if (conn->bev) {
+      bufferevent_free(conn->bev);
+    }
+
+    event_free(conn->timer);
+  }
+}
+
+static void print_json(const Settings& settings, const std::vector<Worker*>& workers) {
+  bench::Histogram latency;
+  Counters total;
+  uint64_t idle_open = 0;
+
+  memset(&total, 0, sizeof(total));
+
+  for (Worker* w : workers) {
+    latency.add(w->latency);
+    total.requests += w->counters.requests;
+    total.bytes += w->counters.bytes;
+    total.connect_errors += w->counters.connect_errors;
+    total.read_errors += w->counters.read_errors;
+    total.parse_errors += w->counters.parse_errors;
+    total.lost += w->counters.lost;
+    total.idle_closed += w->counters.idle_closed;
+
+    for (int i = 0; i < 6; i++) {
+      total.status[i] += w->counters.status[i];
+    }
+
+    for (Connection* conn : w->connections) {
+      if (conn->idle && conn->connected) {
+        idle_open++;
+      }
+    }
+  }
+
+  double seconds = settings.duration;
+
+  std::cout << std::fixed << std::setprecision(1);
+  std::cout << "{" << std::endl;
+  std::cout << "  \"label\": \"" << settings.label << "\"," << std::endl;
+  std::cout << "  \"target\": \"" << settings.target << "\"," << std::endl;
+  std::cout << "  \"mode\": \"" << (settings.rate > 0 ? "open" : "closed") << "\"," << std::endl;
+  std::cout << "  \"threads\": " << settings.threads << "," << std::endl;
+  std::cout << "  \"connections\": " << settings.connections << "," << std::endl;
+  std::cout << "  \"idle_connections\": " << settings.idle << "," << std::endl;
+  std::cout << "  \"pipeline\": " << settings.depth << "," << std::endl;
+  std::cout << "  \"keep_alive\": " << (settings.keep_alive ? "true" : "false") << "," << std::endl;
+  std::cout << "  \"rate\": " << settings.rate << "," << std::endl;
+  std::cout << "  \"duration\": " << settings.duration << "," << std::endl;
+  std::cout << "  \"corrected\": " << (settings.rate > 0 || settings.interval > 0 ? "true" : "false") << ","
+    << std::endl;
+  std::cout << "  \"requests\": " << total.requests << "," << std::endl;
+  std::cout << "  \"bytes\": " << total.bytes << "," << std::endl;
+  std::cout << "  \"requests_per_second\": " << total.requests / seconds << "," << std::endl;
+  std::cout << "  \"bytes_per_second\": " << total.bytes / seconds << "," << std::endl;
+  std::cout << "  \"status\": { \"1xx\": " << total.status[1] << ", \"2xx\": " << total.status[2]
+    << ", \"3xx\": " << total.status[3] << ", \"4xx\": " << total.status[4] << ", \"5xx\": " << total.status[5]
+    << ", \"other\": " << total.status[0] << " }," << std::endl;
+  std::cout << "  \"errors\": { \"connect\": " << total.connect_errors << ", \"read\": " << total.read_errors
+    << ", \"parse\": " << total.parse_errors << ", \"lost\": " << total.lost << " }," << std::endl;
+  std::cout << "  \"idle\": { \"open\": " << idle_open << ", \"closed\": " << total.idle_closed << " }," << std::endl;
+  std::cout << "  \"latency_us\": {" << std::endl;
+  std::cout << "    \"min\": " << latency.min() << "," << std::endl;
+  std::cout << "    \"mean\": " << latency.mean() << "," << std::endl;
+  std::cout << "    \"stddev\": " << latency.stddev() << "," << std::endl;
+
+  const char* names[] = { "p50", "p75", "p90", "p99", "p99.9", "p99.99" };
+  double percentiles[] = { 50, 75, 90, 99, 99.9, 99.99 };
+
+  for (int i = 0; i < 6; i++) {
+    std::cout << "    \"" << names[i] << "\": " << latency.percentile(percentiles[i]) << "," << std::endl;
+  }
+
+  std::cout << "    \"max\": " << latency.max() << std::endl;
+  std::cout << "  }" << std::endl;
+  std::cout << "}" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  Settings settings;
+  std::vector<std::string> paths;
+  std::vector<std::string> headers;
+  std::string target = "127.0.0.1:5555";
+  int opt;
+
+  settings.threads = 1;
+  settings.connections = 16;
+  settings.idle = 0;
+  settings.duration = 10;
+  settings.warmup = 1;
+  settings.rate = 0;
+  settings.depth = 1;
+  settings.interval = 0;
+  settings.keep_alive = true;
+
+  while ((opt = getopt(argc, argv, "u:t:c:I:d:W:r:P:i:kH:f:l:h")) != -1) {
+    switch (opt) {
+      case 'u': target = optarg; break;
+      case 't': settings.threads = atoi(optarg); break;
+      case 'c': settings.connections = atoi(optarg); break;
+      case 'I': settings.idle = atoi(optarg); break;
+      case 'd': settings.duration = atoi(optarg); break;
+      case 'W': settings.warmup = atoi(optarg); break;
+      case 'r': settings.rate = atof(optarg); break;
+      case 'P': settings.depth = atoi(optarg); break;
+      case 'i': settings.interval = atoll(optarg); break;
+      case 'k': settings.keep_alive = false; break;
+      case 'H': headers.push_back(optarg); break;
+      case 'l': settings.label = optarg; break;
+      case 'f': {
+        std::ifstream file(optarg);
+        std::string path;
+
+        if (!file) {
+          std::cerr << "Unable to read " << optarg << std::endl;
+          return 1;
+        }
+
+        while (std::getline(file, path)) {
+          if (!path.empty()) {
+            paths.push_back(path);
+          }
+        }
+        break;
+      }
+      default:
+        std::cerr << USAGE;
+        return opt == 'h' ? 0 : 1;
+    }
+  }
+
+  for (int i = optind; i < argc; i++) {
+    paths.push_back(argv[i]);
+  }
+
+  if (paths.empty()) {
+    paths.push_back("/");
+  }
+
+  if (settings.threads < 1 || settings.connections < 1 || settings.depth < 1 || settings.duration < 1) {
+    std::cerr << USAGE;
+    return 1;
+  }
+
+  settings.target = target;
+  settings.addr_len = sizeof(settings.addr);
+
+  if (evutil_parse_sockaddr_port(target.c_str(), (struct sockaddr*)&settings.addr, &settings.addr_len) < 0) {
+    std::cerr << "Invalid address " << target << std::endl;
+    return 1;
+  }
+
+  // the requests are built once and written as they are
+  for (const std::string& path : paths) {
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: " + target + "\r\n";
+
+    for (const std::string& header : headers) {
+      request += header + "\r\n";
+    }
+
+    if (!settings.keep_alive) {
+      request += "Connection: close\r\n";
+    }
+
+    settings.requests.push_back(request + "\r\n");
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  std::vector<Worker*> workers;
+
+  for (int i = 0; i < settings.threads; i++) {
+    Worker* worker = new Worker();
+    worker->settings = &settings;
+    worker->base = event_base_new();
+    worker->interval = settings.rate > 0 ? (nanos)(1e9 * settings.connections / settings.rate) : 0;
+    memset(&worker->counters, 0, sizeof(worker->counters));
+    workers.push_back(worker);
+  }
+
+  for (int i = 0; i < settings.connections + settings.idle; i++) {
+    Worker* worker = workers[i % settings.threads];
+    Connection* conn = new Connection();
+
+    conn->worker = worker;
+    conn->index = i;
+    conn->idle = i >= settings.connections;
+    conn->next_request = i;
+    worker->connections.push_back(conn);
+  }
+
+  std::vector<std::thread> threads;
+
+  for (Worker* worker : workers) {
+    threads.emplace_back(run, worker);
+  }
+
+  for (std::thread& t : threads) {
+    t.join();
+  }
+
+  print_json(settings, workers);
+
+  for (Worker* worker : workers) {
+    for (Connection* conn : worker->connections) {
+      delete conn;
+    }
+
+    event_base_free(worker->base);
+    delete worker;
+  }
+
+  return 0;
+}
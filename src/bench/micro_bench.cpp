@@ -0,0 +1,278 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <stringutils.hpp>
+#include <ioutils.hpp>
+#include <http/request.hpp>
+#include <http/response.hpp>
+#include <http/mime_types.hpp>
+#include <http/site.hpp>
+#include <http/file_handler.hpp>
+#include <cache/content_cache.hpp>
+
+/**
+ * Microbenchmarks of the helpers on the request path. Every benchmark reports the time and
+ * the number of heap allocations per operation; the latter are counted by replacing the
+ * global operator new. Run with --max-allocs N to fail if serving a cached file takes more
+ * than N allocations per request.
+ */
+
+static uint64_t allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+
+  if (void* p = malloc(size ? size : 1)) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  allocations++;
+  return malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+/**
+ * The helpers as they used to be, taking their arguments by value
+ */
+namespace before {
+  static std::string chop(const std::string &t, const std::string &ws) {
+    std::string str = t;
+    size_t found = str.find_last_not_of(ws);
+
+    if (found != std::string::npos) {
+      str.erase(found + 1);
+    } else {
+      str.clear();
+    }
+
+    return str;
+  }
+
+  static bool isDirectory(std::string path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+  }
+
+  static bool isFile(std::string filename) {
+    if (isDirectory(filename)) {
+      return false;
+    }
+
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    return (bool)in;
+  }
+
+  static std::ifstream::pos_type filesize(std::string filename) {
+    std::ifstream in(filename.c_str(), std::ifstream::binary | std::ifstream::ate);
+    return in.tellg();
+  }
+
+  /**
+   * Splits an Accept-Encoding header into trimmed names with substrings
+   */
+  static size_t codings(const std::string& header) {
+    size_t n = 0;
+    size_t pos = 0;
+
+    while (pos < header.size()) {
+      size_t end = header.find(',', pos);
+      if (end == std::string::npos) {
+        end = header.size();
+      }
+
+      std::string item = header.substr(pos, end - pos);
+      pos = end + 1;
+
+      std::string name = chop(item.substr(0, item.find(';')), " \t");
+      name.erase(0, name.find_first_not_of(" \t"));
+      n += name.size();
+    }
+
+    return n;
+  }
+};
+
+/**
+ * The same split with slices
+ */
+static size_t codings(const std::string& header) {
+  size_t n = 0;
+  const char* pos = header.c_str();
+  const char* last = pos + header.size();
+
+  while (pos < last) {
+    const char* end = (const char*)memchr(pos, ',', last - pos);
+    if (!end) {
+      end = last;
+    }
+
+    const char* params = (const char*)memchr(pos, ';', end - pos);
+    n += string::utils::trimmed(string::slice(pos, (params ? params : end) - pos), " \t").size;
+    pos = end + 1;
+  }
+
+  return n;
+}
+
+struct Result {
+  double ns;
+  double allocs;
+};
+
+/**
+ * Runs a benchmark for at least a fifth of a second
+ */
+static Result measure(const std::function<size_t()>& op) {
+  size_t sink = 0;
+  long iterations = 1;
+
+  while (true) {
+    uint64_t allocated = allocations;
+    auto started = std::chrono::steady_clock::now();
+
+    for (long i = 0; i < iterations; i++) {
+      sink += op();
+    }
+
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+    if (elapsed.count() >= 0.2 || iterations >= (1L << 30)) {
+      // keep the compiler from dropping the loop
+      if (sink == 1) {
+        std::cout << "";
+      }
+
+      return Result { elapsed.count() * 1e9 / iterations, (double)(allocations - allocated) / iterations };
+    }
+
+    iterations *= elapsed.count() > 0.02 ? 0.25 / elapsed.count() : 10;
+  }
+}
+
+int main(int argc, char** argv) {
+  const char* filter = NULL;
+  double max_allocs = -1;
+
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--max-allocs") && i + 1 < argc) {
+      max_allocs = atof(argv[++i]);
+    } else if (!strcmp(argv[i], "--filter") && i + 1 < argc) {
+      filter = argv[++i];
+    } else {
+      std::cerr << "usage: salthttpd-microbench [--filter name] [--max-allocs n]" << std::endl;
+      return 1;
+    }
+  }
+
+  // a small document root to stat, open and serve
+  char root_template[] = "/tmp/salthttpd-microbench.XXXXXX";
+  std::string root = mkdtemp(root_template);
+  std::string file = root + "/index.html";
+  std::ofstream(file.c_str()) << "<html><body>hello</body></html>" << std::endl;
+  mkdir((root + "/errors").c_str(), 0755);
+  std::ofstream((root + "/errors/404.html").c_str()) << "not found" << std::endl;
+
+  http::MimeTypes mime_types("utf-8", "text/plain");
+  cache::ContentCache content_cache(1 << 20, 1 << 16, 1000, std::vector<std::string>());
+  http::Site site(root, root + "/errors", mime_types);
+  http::FileHandler cached(site, mime_types, false, &content_cache, NULL);
+  http::FileHandler uncached(site, mime_types, false, NULL, NULL);
+
+  std::string padded_root = "/var/www/htdocs///";
+  std::string uri = "/css/site.css";
+  std::string accept_encoding = "gzip, deflate;q=0.5, br;q=1.0, identity; q=0";
+
+  http::Request request;
+  request.uri = "/index.html";
+  request.path = request.uri;
+
+  http::Request missing;
+  missing.uri = "/missing.html";
+  missing.path = missing.uri;
+
+  std::vector<std::pair<std::string, std::function<size_t()>>> benchmarks = {
+    { "chop/copy", [&] { return before::chop(padded_root, "/").size(); } },
+    { "chop/slice", [&] { return string::utils::chopped(padded_root, "/").size; } },
+    { "isFile/by_value", [&] { return (size_t)before::isFile(file); } },
+    { "isFile/stat", [&] { return (size_t)io::utils::isFile(file); } },
+    { "isDirectory/by_value", [&] { return (size_t)before::isDirectory(root); } },
+    { "isDirectory/stat", [&] { return (size_t)io::utils::isDirectory(root); } },
+    { "filesize/ifstream", [&] { return (size_t)before::filesize(file); } },
+    { "filesize/stat", [&] { return (size_t)io::utils::filesize(file); } },
+    { "path/concat", [&] { return (root + uri).size(); } },
+    { "accept_encoding/substr", [&] { return before::codings(accept_encoding); } },
+    { "accept_encoding/slice", [&] { return codings(accept_encoding); } },
+    { "mime/lookup", [&] { return mime_types.lookup("/var/www/htdocs/js/app.js").size(); } },
+    { "handle/cached", [&] { http::Response res; cached.handle(request, res); return (size_t)res.getStatus(); } },
+    { "handle/uncached", [&] { http::Response res; uncached.handle(request, res); return (size_t)res.getStatus(); } },
+    { "handle/not_found", [&] { http::Response res; cached.handle(missing, res); return (size_t)res.getStatus(); } },
+  };
+
+  int status = 0;
+
+  std::cout << std::left << std::setw(28) << "benchmark" << std::right << std::setw(12) << "ns/op"
+    << std::setw(12) << "allocs/op" << std::endl;
+  std::cout << std::fixed << std::setprecision(1);
+
+  for (auto& benchmark : benchmarks) {
+    if (filter && benchmark.first.find(filter) == std::string::npos) {
+      continue;
+    }
+
+    Result result = measure(benchmark.second);
+    std::cout << std::left << std::setw(28) << benchmark.first << std::right << std::setw(12) << result.ns
+      << std::setw(12) << result.allocs << std::endl;
+
+    if (max_allocs >= 0 && benchmark.first == "handle/cached" && result.allocs > max_allocs) {
+      std::cerr << "handle/cached makes " << result.allocs << " allocations per request, more than "
+        << max_allocs << std::endl;
+      status = 1;
+    }
+  }
+
+  unlink((root + "/errors/404.html").c_str());
+  rmdir((root + "/errors").c_str());
+  unlink(file.c_str());
+  rmdir(root.c_str());
+
+  return status;
+}
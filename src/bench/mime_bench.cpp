@@ -0,0 +1,105 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <event2/util.h>
+
+#include <http/mime_types.hpp>
+
+/**
+ * The lookup the file handler used to do: a linear, case-insensitive scan
+ */
+static const struct table_entry {
+  const char *extension;
+  const char *content_type;
+} content_type_table[] = {
+  { "txt", "text/plain" },
+  { "css", "text/css" },
+  { "js", "application/x-javascript" },
+  { "html", "text/html" },
+  { "htm", "text/htm" },
+  { "gif", "image/gif" },
+  { "jpg", "image/jpeg" },
+  { "jpeg", "image/jpeg" },
+  { "png", "image/png" },
+  { NULL, NULL },
+};
+
+static const char* guess_content_type(const char *path) {
+  const char *last_period, *extension;
+  const struct table_entry *ent;
+  last_period = strrchr(path, '.');
+  if (!last_period || strchr(last_period, '/'))
+    goto not_found;
+
+  extension = last_period + 1;
+  for (ent = &content_type_table[0]; ent->extension; ++ent) {
+    if (!evutil_ascii_strcasecmp(ent->extension, extension))
+      return ent->content_type;
+  }
+
+  not_found:
+    return "text/plain";
+}
+
+/**
+ * A mix of paths, some found early in the old table, some late and some not at all
+ */
+static const char* paths[] = {
+  "/var/www/htdocs/index.html",
+  "/var/www/htdocs/css/site.css",
+  "/var/www/htdocs/js/app.JS",
+  "/var/www/htdocs/img/logo.png",
+  "/var/www/htdocs/img/photo.jpeg",
+  "/var/www/htdocs/fonts/body.woff2",
+  "/var/www/htdocs/data/feed.json",
+  "/var/www/htdocs/README",
+};
+
+static const size_t path_count = sizeof(paths) / sizeof(paths[0]);
+
+template<class F>
+static double lookups_per_second(F lookup, long iterations) {
+  size_t sink = 0;
+  auto started = std::chrono::steady_clock::now();
+
+  for (long i = 0; i < iterations; i++) {
+    sink += lookup(paths[i % path_count]);
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+
+  // keep the compiler from dropping the loop
+  if (sink == 1) {
+    std::cout << "";
+  }
+
+  return iterations / elapsed.count();
+}
+
+int main(int argc, char** argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 10000000;
+
+  http::MimeTypes mime_types("utf-8", "text/plain");
+
+  if (argc > 2) {
+    mime_types.load(argv[2]);
+  }
+
+  double scan = lookups_per_second([](const char* path) {
+    return (size_t)guess_content_type(path)[0];
+  }, iterations);
+
+  double table = lookups_per_second([&mime_types](const char* path) {
+    return mime_types.lookup(path).size();
+  }, iterations);
+
+  std::cout << std::left << std::setw(12) << "lookup" << "lookups/s" << std::endl;
+  std::cout << std::setw(12) << "scan" << (uint64_t)scan << std::endl;
+  std::cout << std::setw(12) << "table" << (uint64_t)table << " (" << mime_types.size() << " extensions)"
+    << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+
+#include <concurrency/executor.hpp>
+#include <concurrency/thread_pool.hpp>
+#include <concurrency/work_stealing_pool.hpp>
+#include <concurrency/sharded_pool.hpp>
+
+/**
+ * Measures how many tasks per second a scheduler accepts and runs when fed by
+ * a number of producer threads at once. Keyed tasks carry the number of their producer,
+ * like requests carry their connection.
+ */
+static double run(concurrency::Executor& pool, int producers, int tasks, bool keyed = false) {
+  std::atomic<int> done(0);
+  int per_producer = tasks / producers;
+  int total = per_producer * producers;
+
+  auto started = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&pool, &done, per_producer, keyed, p] {
+      for (int i = 0; i < per_producer; i++) {
+        auto task = [&done] {
+          done.fetch_add(1, std::memory_order_relaxed);
+        };
+
+        if (keyed) {
+          pool.pushFor(p, task);
+        } else {
+          pool.push(task);
+        }
+      }
+    });
+  }
+
+  for (std::thread& t : threads) {
+    t.join();
+  }
+
+  while (done.load() < total) {
+    std::this_thread::yield();
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+  return total / elapsed.count();
+}
+
+int main(int argc, char** argv) {
+  int tasks = argc > 1 ? atoi(argv[1]) : 200000;
+  int workers = std::thread::hardware_concurrency();
+
+  if (workers < 4) {
+    workers = 4;
+  }
+
+  std::cout << "tasks=" << tasks << " workers=" << workers << std::endl;
+  std::cout << std::left << std::setw(12) << "scheduler" << std::setw(12) << "producers" << "tasks/s" << std::endl;
+
+  int producer_counts[] = { 1, 4, 16, 64 };
+
+  for (int producers : producer_counts) {
+    {
+      concurrency::ThreadPool pool(workers, true);
+      pool.start();
+      double rate = run(pool, producers, tasks);
+      std::cout << std::setw(12) << "queue" << std::setw(12) << producers << (uint64_t)rate << std::endl;
+    }
+
+    {
+      concurrency::WorkStealingPool pool(workers, 65536, true);
+      pool.start();
+      double rate = run(pool, producers, tasks);
+      std::cout << std::setw(12) << "stealing" << std::setw(12) << producers << (uint64_t)rate << std::endl;
+    }
+
+    {
+      concurrency::ShardedPool pool(workers, workers, 0, true, false);
+      pool.start();
+      double rate = run(pool, producers, tasks, true);
+      std::cout << std::setw(12) << "sharded" << std::setw(12) << producers << (uint64_t)rate << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,139 @@
+#!/bin/bash
+#
+# Runs the load scenarios against a freshly started salthttpd, once per server mode, and
+# prints the results as a single JSON document:
+#
+#   { "pool": { "hot-set": { ... }, ... }, "reactor": { ... } }
+#
+# usage: scenarios.sh [-m "pool reactor"] [-d seconds] [-t threads] [-L megabytes] [-c config] [-s scenario]
+#
+# The binaries are taken from the build directory next to this script, or from $SALTHTTPD
+# and $SALTHTTPD_BENCH.
+
+set -e
+
+dir=$(cd "$(dirname "$0")" && pwd)
+server=${SALTHTTPD:-$dir/../salthttpd}
+bench=${SALTHTTPD_BENCH:-$dir/../salthttpd-bench}
+
+modes="pool"
+duration=10
+threads=2
+large_mb=64
+config=""
+only=""
+port=${PORT:-18181}
+
+while getopts "m:d:t:L:c:s:p:h" opt; do
+  case $opt in
+    m) modes=$OPTARG ;;
+    d) duration=$OPTARG ;;
+    t) threads=$OPTARG ;;
+    L) large_mb=$OPTARG ;;
+    c) config=$OPTARG ;;
+    s) only=$OPTARG ;;
+    p) port=$OPTARG ;;
+    *) sed -n '3,12p' "$0" | sed 's/^# \{0,1\}//'; exit 1 ;;
+  esac
+done
+
+for binary in "$server" "$bench"; do
+  if [ ! -x "$binary" ]; then
+    echo "$binary not found, run make and make bench first" >&2
+    exit 1
+  fi
+done
+
+# the idle connection scenario needs a few thousand descriptors on both ends
+ulimit -n 65536 2>/dev/null || ulimit -n 8192 2>/dev/null || true
+
+fixture=$(mktemp -d)
+server_pid=""
+
+cleanup() {
+  [ -n "$server_pid" ] && kill "$server_pid" 2>/dev/null && wait "$server_pid" 2>/dev/null
+  rm -rf "$fixture"
+}
+trap cleanup EXIT
+
+# a hot set of small pages, a large file and a list of missing ones
+mkdir -p "$fixture/htdocs/hot" "$fixture/errors"
+cp "$dir/../../errors/"*.html "$fixture/errors/"
+
+for i in $(seq -w 0 63); do
+  size=$(( (10#$i % 16 + 1) * 1024 ))
+  head -c $(( size * 3 / 4 )) /dev/urandom | base64 -w 100 > "$fixture/htdocs/hot/page$i.html"
+  echo "/hot/page$i.html" >> "$fixture/hot.txt"
+  echo "/missing/page$i.html" >> "$fixture/missing.txt"
+done
+
+head -c $(( large_mb * 1024 * 1024 )) /dev/urandom > "$fixture/htdocs/large.bin"
+
+start_server() {
+  local args=(-p "$port" -d "$fixture/htdocs" -e "$fixture/errors" -m "$1")
+  [ -n "$config" ] && args+=(-c "$config")
+
+  "$server" "${args[@]}" > "$fixture/server-$1.log" 2>&1 &
+  server_pid=$!
+
+  for i in $(seq 1 50); do
+    if (exec 3<>/dev/tcp/127.0.0.1/$port) 2>/dev/null; then
+      return 0
+    fi
+    sleep 0.1
+  done
+
+  echo "salthttpd did not come up:" >&2
+  cat "$fixture/server-$1.log" >&2
+  exit 1
+}
+
+stop_server() {
+  kill -INT "$server_pid"
+  wait "$server_pid" 2>/dev/null || true
+  server_pid=""
+}
+
+# name and load generator arguments of every scenario
+scenarios=(
+  "hot-set|-c 64 -f $fixture/hot.txt"
+  "hot-set-pipelined|-c 16 -P 8 -f $fixture/hot.txt"
+  "hot-set-open-loop|-c 64 -r 5000 -f $fixture/hot.txt"
+  "large-file|-c 8 /large.bin"
+  "not-found|-c 64 -f $fixture/missing.txt"
+  "idle-connections|-c 16 -I 2000 -r 2000 -f $fixture/hot.txt"
+)
+
+echo "{"
+first_mode=1
+
+for mode in $modes; do
+  [ $first_mode = 1 ] || echo ","
+  first_mode=0
+
+  start_server "$mode"
+
+  echo "  \"$mode\": {"
+  first=1
+
+  for scenario in "${scenarios[@]}"; do
+    name=${scenario%%|*}
+    args=${scenario#*|}
+
+    if [ -n "$only" ] && [ "$only" != "$name" ]; then
+      continue
+    fi
+
+    [ $first = 1 ] || echo ","
+    first=0
+
+    echo "    \"$name\": "
+    # shellcheck disable=SC2086
+    "$bench" -u "127.0.0.1:$port" -t "$threads" -d "$duration" -l "$mode/$name" $args | sed 's/^/    /'
+  done
+
+  echo "  }"
+  stop_server
+done
+
+echo "}"
@@ -0,0 +1,136 @@
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <cstdlib>
+#include <new>
+
+#include <concurrency/executor.hpp>
+#include <concurrency/thread_pool.hpp>
+#include <concurrency/work_stealing_pool.hpp>
+
+/**
+ * Counts every heap allocation made by the process
+ */
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+/**
+ * A capture the size of a typical request task: a few pointers and a length
+ */
+struct SmallCapture {
+  void* reactor;
+  void* request;
+  std::atomic<int>* done;
+  size_t length;
+
+  void operator()() {
+    done->fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+/**
+ * A capture too large for the inline buffer of a task
+ */
+struct LargeCapture {
+  char payload[160];
+  std::atomic<int>* done;
+
+  void operator()() {
+    done->fetch_add(1, std::memory_order_relaxed);
+  }
+};
+
+static void wait_for(std::atomic<int>& done, int n) {
+  while (done.load() < n) {
+    std::this_thread::yield();
+  }
+}
+
+template<class Capture>
+static double allocations_per_task(concurrency::Executor& pool, int tasks) {
+  std::atomic<int> done(0);
+  Capture c = Capture();
+  c.done = &done;
+
+  // warm up, so that queues and slabs have grown to their working size and
+  // blocks freed by the workers have made it back to this thread
+  for (int round = 0; round < 5; round++) {
+    done = 0;
+    for (int i = 0; i < tasks; i++) {
+      pool.push(c);
+    }
+    wait_for(done, tasks);
+  }
+
+  done = 0;
+  uint64_t before = allocations.load();
+
+  for (int i = 0; i < tasks; i++) {
+    pool.push(c);
+  }
+  wait_for(done, tasks);
+
+  return (double)(allocations.load() - before) / tasks;
+}
+
+static void report(const char* name, concurrency::Executor& pool, int tasks) {
+  double small = allocations_per_task<SmallCapture>(pool, tasks);
+  double large = allocations_per_task<LargeCapture>(pool, tasks);
+
+  std::cout << std::setw(12) << name << std::setw(16) << small << large << std::endl;
+}
+
+int main(int argc, char** argv) {
+  int tasks = argc > 1 ? atoi(argv[1]) : 100000;
+
+  std::cout << std::left << std::setw(12) << "scheduler" << std::setw(16) << "small allocs" << "large allocs"
+    << " (per task, steady state)" << std::endl;
+
+  {
+    concurrency::ThreadPool pool(4, true);
+    pool.start();
+    report("queue", pool, tasks);
+  }
+
+  {
+    concurrency::WorkStealingPool pool(4, 65536, true);
+    pool.start();
+    report("stealing", pool, tasks);
+  }
+
+  // for comparison, what wrapping the same callables in std::function costs
+  std::atomic<int> done(0);
+  uint64_t before = allocations.load();
+
+  for (int i = 0; i < tasks; i++) {
+    LargeCapture c = LargeCapture();
+    c.done = &done;
+    std::function<void()> f(c);
+    f();
+  }
+
+  std::cout << std::setw(12) << "function" << std::setw(16) << "-"
+    << (double)(allocations.load() - before) / tasks << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <cache/content_cache.hpp>
+
+#include <unistd.h>
+
+#include <cache/sidecars.hpp>
+
+static bool same_file(const cache::CachedFile& f, const struct stat& st) {
+  return f.ino == st.st_ino && f.dev == st.st_dev && f.size == st.st_size
+    && f.mtime.tv_sec == st.st_mtim.tv_sec && f.mtime.tv_nsec == st.st_mtim.tv_nsec;
+}
+
+cache::ContentCache::ContentCache(size_t b, size_t f, int validity_ms, const std::vector<std::string>& s)
+  : max_bytes(b), max_file_size(f), validity(std::chrono::milliseconds(validity_ms)), sidecars(s), mutex(), lru(), index(), used_bytes(0), hits(0), misses(0), evictions(0) {
+}
+
+void cache::ContentCache::erase(std::list<Entry>::iterator it) {
+  used_bytes -= it->file->body->size();
+  index.erase(it->path);
+  lru.erase(it);
+}
+
+cache::ContentCache::FilePtr cache::ContentCache::lookup(const std::string& path) {
+  FilePtr file;
+  clock::time_point now = clock::now();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(path);
+
+    // a miss is counted once the file is known to fit and is loaded
+    if (it == index.end()) {
+      return nullptr;
+    }
+
+    lru.splice(lru.begin(), lru, it->second);
+
+    if (now - it->second->validated < validity) {
+      hits++;
+      return it->second->file;
+    }
+
+    file = it->second->file;
+  }
+
+  // the entry is stale, check it against the file system without holding the lock
+  struct stat st;
+  bool valid = stat(path.c_str(), &st) == 0 && same_file(*file, st)
+    && probe_sidecars(path, sidecars) == file->sidecars;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(path);
+
+  if (it != index.end() && it->second->file == file) {
+    if (valid) {
+      it->second->validated = now;
+    } else {
+      erase(it->second);
+    }
+  }
+
+  if (!valid) {
+    return nullptr;
+  }
+
+  hits++;
+  return file;
+}
+
+cache::ContentCache::FilePtr cache::ContentCache::load(const std::string& path, int fd, const char* content_type) {
+  struct stat st;
+
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || !fits(st.st_size)) {
+    return nullptr;
+  }
+
+  misses++;
+
+  std::string* body = new std::string(st.st_size, '\0');
+  std::shared_ptr<const std::string> data(body);
+  size_t done = 0;
+
+  while (done < body->size()) {
+    ssize_t n = pread(fd, &(*body)[done], body->size() - done, done);
+
+    if (n <= 0) {
+      break;
+    }
+
+    done += n;
+  }
+
+  // the file shrank while we read it, let the next request try again
+  if (done != body->size()) {
+    return nullptr;
+  }
+
+  CachedFile* f = new CachedFile();
+  f->body = data;
+  f->content_type = content_type;
+  f->dev = st.st_dev;
+  f->ino = st.st_ino;
+  f->size = st.st_size;
+  f->mtime = st.st_mtim;
+  f->validators = http::Validators(st.st_ino, st.st_size, st.st_mtim, data.get());
+  f->sidecars = probe_sidecars(path, sidecars);
+  FilePtr file(f);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(path);
+
+  if (it != index.end()) {
+    erase(it->second);
+  }
+
+  while (!lru.empty() && used_bytes + body->size() > max_bytes) {
+    erase(std::prev(lru.end()));
+    evictions++;
+  }
+
+  lru.push_front(Entry { path, file, clock::now() });
+  index[path] = lru.begin();
+  used_bytes += body->size();
+
+  return file;
+}
+
+cache::ContentCacheStats cache::ContentCache::stats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return ContentCacheStats { hits.load(), misses.load(), evictions.load(), used_bytes, lru.size() };
+}
@@ -0,0 +1,180 @@
+#ifndef CONTENT_CACHE_HPP
+#define CONTENT_CACHE_HPP
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <http/validators.hpp>
+
+namespace cache {
+  /**
+   * A file held in memory by the ContentCache. Entries are immutable and shared,
+   * so a response can keep sending one after it has been evicted.
+   */
+  struct CachedFile {
+    /**
+     * The contents of the file
+     */
+    std::shared_ptr<const std::string> body;
+
+    /**
+     * The content type to send with the file
+     */
+    std::string content_type;
+
+    /**
+     * The stat data the entry was loaded with, used to revalidate it
+     */
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+
+    /**
+     * The ETag and Last-Modified values, formatted when the file was loaded
+     */
+    http::Validators validators;
+
+    /**
+     * Which of the cache's sidecar suffixes exist next to the file, one bit each
+     */
+    unsigned sidecars;
+  };
+
+  /**
+   * Counters describing how well the cache is doing
+   */
+  struct ContentCacheStats {
+    uint64_t hits;
+
+    /**
+     * Files read into the cache; files too large for it are no misses
+     */
+    uint64_t misses;
+
+    uint64_t evictions;
+    size_t bytes;
+    size_t entries;
+  };
+
+  /**
+   * An in-memory cache of small files, keyed by their resolved path. The cache is bounded
+   * by the total size of the files it holds and evicts the least recently used file first.
+   * Entries are revalidated against the file system at most once per validity interval.
+   */
+  class ContentCache {
+    protected:
+      typedef std::shared_ptr<const CachedFile> FilePtr;
+      typedef std::chrono::steady_clock clock;
+
+      struct Entry {
+        std::string path;
+        FilePtr file;
+        clock::time_point validated;
+      };
+
+      /**
+       * The maximum number of bytes held by the cache
+       */
+      size_t max_bytes;
+
+      /**
+       * Files larger than this are never cached
+       */
+      size_t max_file_size;
+
+      /**
+       * How long an entry is trusted before it is checked against the file system
+       */
+      clock::duration validity;
+
+      /**
+       * The suffixes of sidecar files whose existence is kept with every entry
+       */
+      std::vector<std::string> sidecars;
+
+      /**
+       * Mutex for the LRU list and the index
+       */
+      std::mutex mutex;
+
+      /**
+       * The entries, most recently used first
+       */
+      std::list<Entry> lru;
+
+      /**
+       * Maps a path onto its entry in the LRU list
+       */
+      std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+      /**
+       * The number of bytes currently held
+       */
+      size_t used_bytes;
+
+      std::atomic<uint64_t> hits;
+      std::atomic<uint64_t> misses;
+      std::atomic<uint64_t> evictions;
+
+      /**
+       * Removes an entry. The mutex must be held.
+       */
+      void erase(std::list<Entry>::iterator it);
+
+    public:
+      /**
+       * Creates a new content cache
+       * @param max_bytes the memory budget of the cache
+       * @param max_file_size the largest file that will be cached
+       * @param validity_ms how long, in milliseconds, an entry is trusted without a stat
+       * @param sidecars the suffixes of sidecar files to look for next to every file
+       */
+      ContentCache(size_t max_bytes, size_t max_file_size, int validity_ms, const std::vector<std::string>& sidecars);
+
+      /**
+       * Returns whether or not a file of a size would be held by the cache, so that files that
+       * never will are not offered to it
+       * @param size the size of the file
+       * @return true if the file fits
+       */
+      bool fits(off_t size) const {
+        return (size_t)size <= max_file_size && (size_t)size <= max_bytes;
+      }
+
+      /**
+       * Looks up a cached file, revalidating it if its validity has run out
+       * @param path the resolved path of the file
+       * @return the cached file, or nullptr on a miss
+       */
+      FilePtr lookup(const std::string& path);
+
+      /**
+       * Reads a file the caller has opened into the cache. The descriptor is read with pread()
+       * and left open, so it may be shared.
+       * @param path the resolved path of the file
+       * @param fd the open file
+       * @param content_type the content type to store with it
+       * @return the cached file, or nullptr if the file is not a regular file, too large or changed
+       *         while it was read
+       */
+      FilePtr load(const std::string& path, int fd, const char* content_type);
+
+      /**
+       * Returns the current counters of the cache
+       * @return the cache statistics
+       */
+      ContentCacheStats stats();
+  };
+};
+#endif
@@ -0,0 +1,384 @@
+#include <cache/fd_cache.hpp>
+
+#include <functional>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+#include <cache/sidecars.hpp>
+
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE
+  | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+
+cache::OpenFile::~OpenFile() {
+  if (fd != -1) {
+    close(fd);
+  }
+}
+
+cache::FdCache::FdCache(size_t max_entries, int inactive_ms, const std::vector<std::string>& s)
+  : max_shard_entries((max_entries + SHARD_COUNT - 1) / SHARD_COUNT), inactive(std::chrono::milliseconds(inactive_ms)),
+    sidecars(s), opener(open_path), root(), inotify_fd(-1), wakeup_fd(-1), watch_mutex(), watch_dirs(), dir_watches(), watcher(),
+    hits(0), misses(0), invalidations(0) {
+  inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (inotify_fd == -1) {
+    return;
+  }
+
+  wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+  if (wakeup_fd == -1) {
+    close(inotify_fd);
+    inotify_fd = -1;
+    return;
+  }
+
+  watcher = std::thread([this] {
+    run();
+  });
+}
+
+cache::FdCache::~FdCache() {
+  if (watcher.joinable()) {
+    uint64_t one = 1;
+    ssize_t n = write(wakeup_fd, &one, sizeof(one));
+    (void)n;
+    watcher.join();
+  }
+
+  if (inotify_fd != -1) {
+    close(inotify_fd);
+  }
+
+  if (wakeup_fd != -1) {
+    close(wakeup_fd);
+  }
+}
+
+cache::FdCache::Shard& cache::FdCache::shard(const std::string& path) {
+  return shards[std::hash<std::string>()(path) % SHARD_COUNT];
+}
+
+bool cache::FdCache::watch(const std::string& path) {
+  size_t slash = path.find_last_of('/');
+  std::string dir = slash == std::string::npos ? "." : path.substr(0, slash);
+
+  // the root and every directory below it down to the file, or only the file's own
+  size_t end = dir.size();
+
+  if (!root.empty() && dir.compare(0, root.size(), root) == 0
+    && (dir.size() == root.size() || dir[root.size()] == '/')) {
+    end = root.size();
+  }
+
+  std::lock_guard<std::mutex> lock(watch_mutex);
+
+  while (true) {
+    std::string ancestor = dir.substr(0, end);
+
+    if (dir_watches.find(ancestor) == dir_watches.end()) {
+      int wd = inotify_add_watch(inotify_fd, ancestor.empty() ? "/" : ancestor.c_str(), WATCH_MASK);
+
+      if (wd == -1) {
+        return false;
+      }
+
+      // the same directory may be spelled in several ways, each is its own key
+      std::string& spellings = watch_dirs[wd];
+      spellings.append(ancestor).push_back('\0');
+      dir_watches[ancestor] = wd;
+    }
+
+    if (end == dir.size()) {
+      return true;
+    }
+
+    end = dir.find('/', end + 1);
+
+    if (end == std::string::npos) {
+      end = dir.size();
+    }
+  }
+}
+
+bool cache::FdCache::forget(const std::string& dir) {
+  std::string prefix = dir + "/";
+  bool found = false;
+
+  std::lock_guard<std::mutex> lock(watch_mutex);
+
+  for (auto it = dir_watches.lower_bound(dir); it != dir_watches.end();) {
+    if (it->first != dir && it->first.compare(0, prefix.size(), prefix) != 0) {
+      // the spellings below the directory sort right after it, save for siblings such as "dir-old"
+      if (it->first.compare(0, dir.size(), dir) != 0) {
+        break;
+      }
+
+      ++it;
+      continue;
+    }
+
+    auto w = watch_dirs.find(it->second);
+
+    if (w != watch_dirs.end()) {
+      std::string spelling = it->first + '\0';
+      size_t at = w->second.find(spelling);
+
+      // a spelling is only found at the start of the list or after the end of another one
+      while (at != std::string::npos && at > 0 && w->second[at - 1] != '\0') {
+        at = w->second.find(spelling, at + 1);
+      }
+
+      if (at != std::string::npos) {
+        w->second.erase(at, spelling.size());
+      }
+
+      // the directory is watched anew by its name once a file below it is cached again
+      if (w->second.empty()) {
+        inotify_rm_watch(inotify_fd, w->first);
+        watch_dirs.erase(w);
+      }
+    }
+
+    it = dir_watches.erase(it);
+    found = true;
+  }
+
+  return found;
+}
+
+void cache::FdCache::setOpener(Opener o) {
+  opener = o;
+}
+
+void cache::FdCache::setRoot(const std::string& r) {
+  root = r;
+}
+
+cache::FdCache::FilePtr cache::FdCache::get(const std::string& path, const char* content_type) {
+  if (inotify_fd == -1) {
+    return nullptr;
+  }
+
+  Shard& s = shard(path);
+
+  {
+    std::lock_guard<std::mutex> lock(s.mutex);
+    auto it = s.entries.find(path);
+
+    if (it != s.entries.end()) {
+      it->second.used = clock::now();
+      hits++;
+      return it->second.file;
+    }
+  }
+
+  misses++;
+
+  // watch before opening, so that a change after the open is never missed
+  bool watched = watch(path);
+  uint64_t generation = invalidations.load();
+
+  int fd = opener(path);
+
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  struct stat st;
+
+  int result = fstat(fd, &st);
+
+  if (result != 0 || !S_ISREG(st.st_mode)) {
+    // a directory or a device is no file to serve, just like a missing one
+    int error = result != 0 ? errno : ENOENT;
+    close(fd);
+    errno = error;
+    return nullptr;
+  }
+
+  OpenFile* f = new OpenFile();
+  f->fd = fd;
+  FilePtr file(f);
+
+  f->size = st.st_size;
+  f->dev = st.st_dev;
+  f->ino = st.st_ino;
+  f->mtime = st.st_mtim;
+  f->content_type = content_type;
+  f->validators = http::Validators(st.st_ino, st.st_size, st.st_mtim, NULL);
+  f->sidecars = probe_sidecars(path, sidecars);
+
+  // something was invalidated while we opened the file, serve it but don't trust it
+  if (!watched || invalidations.load() != generation) {
+    return file;
+  }
+
+  std::lock_guard<std::mutex> lock(s.mutex);
+
+  if (s.entries.size() >= max_shard_entries) {
+    auto oldest = s.entries.begin();
+
+    for (auto it = s.entries.begin(); it != s.entries.end(); ++it) {
+      if (it->second.used < oldest->second.used) {
+        oldest = it;
+      }
+    }
+
+    if (oldest != s.entries.end()) {
+      s.entries.erase(oldest);
+    }
+  }
+
+  s.entries[path] = Entry { file, clock::now() };
+
+  return file;
+}
+
+void cache::FdCache::invalidate(const std::string& path) {
+  invalidations++;
+
+  Shard& s = shard(path);
+  std::lock_guard<std::mutex> lock(s.mutex);
+  s.entries.erase(path);
+}
+
+void cache::FdCache::invalidateDirectory(const std::string& dir) {
+  invalidations++;
+
+  std::string prefix = dir + "/";
+
+  for (size_t i = 0; i < SHARD_COUNT; i++) {
+    std::lock_guard<std::mutex> lock(shards[i].mutex);
+
+    for (auto it = shards[i].entries.begin(); it != shards[i].entries.end();) {
+      if (it->first.compare(0, prefix.size(), prefix) == 0) {
+        it = shards[i].entries.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+void cache::FdCache::sweep() {
+  clock::time_point now = clock::now();
+
+  for (size_t i = 0; i < SHARD_COUNT; i++) {
+    std::lock_guard<std::mutex> lock(shards[i].mutex);
+
+    for (auto it = shards[i].entries.begin(); it != shards[i].entries.end();) {
+      if (now - it->second.used > inactive) {
+        it = shards[i].entries.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+void cache::FdCache::run() {
+  struct pollfd fds[2];
+  fds[0].fd = inotify_fd;
+  fds[0].events = POLLIN;
+  fds[1].fd = wakeup_fd;
+  fds[1].events = POLLIN;
+
+  int timeout = std::chrono::duration_cast<std::chrono::milliseconds>(inactive).count() / 2;
+  char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+  while (true) {
+    int n = poll(fds, 2, timeout > 0 ? timeout : 1);
+
+    if (n > 0 && (fds[1].revents & POLLIN)) {
+      break;
+    }
+
+    if (n > 0 && (fds[0].revents & POLLIN)) {
+      ssize_t len;
+
+      while ((len = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + len;) {
+          struct inotify_event* ev = (struct inotify_event*)p;
+          p += sizeof(struct inotify_event) + ev->len;
+
+          if (ev->mask & IN_Q_OVERFLOW) {
+            // events were lost, nothing in the cache can be trusted
+            std::lock_guard<std::mutex> lock(watch_mutex);
+            for (auto it = dir_watches.begin(); it != dir_watches.end(); ++it) {
+              invalidateDirectory(it->first);
+            }
+            continue;
+          }
+
+          std::vector<std::string> dirs;
+
+          {
+            std::lock_guard<std::mutex> lock(watch_mutex);
+            auto it = watch_dirs.find(ev->wd);
+
+            if (it == watch_dirs.end()) {
+              continue;
+            }
+
+            for (size_t start = 0, end; (end = it->second.find('\0', start)) != std::string::npos; start = end + 1) {
+              dirs.push_back(it->second.substr(start, end - start));
+            }
+
+            if (ev->mask & IN_IGNORED) {
+              for (const std::string& dir : dirs) {
+                dir_watches.erase(dir);
+              }
+              watch_dirs.erase(it);
+            }
+          }
+
+          for (const std::string& dir : dirs) {
+            if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+              if (ev->mask & (IN_DELETE_SELF | IN_MOVE_SELF)) {
+                forget(dir);
+              }
+
+              invalidateDirectory(dir);
+            } else if (ev->len > 0) {
+              std::string name(ev->name);
+              invalidate(dir + "/" + name);
+
+              // a watched directory, or a symlink to one, was renamed, replaced or removed, and the
+              // files below it with it
+              if ((ev->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)) && forget(dir + "/" + name)) {
+                invalidateDirectory(dir + "/" + name);
+              }
+
+              // a sidecar appearing or going away changes the file it belongs to
+              for (const std::string& suffix : sidecars) {
+                if (name.size() > suffix.size()
+                  && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0) {
+                  invalidate(dir + "/" + name.substr(0, name.size() - suffix.size()));
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+
+    sweep();
+  }
+}
+
+cache::FdCacheStats cache::FdCache::stats() {
+  size_t entries = 0;
+
+  for (size_t i = 0; i < SHARD_COUNT; i++) {
+    std::lock_guard<std::mutex> lock(shards[i].mutex);
+    entries += shards[i].entries.size();
+  }
+
+  return FdCacheStats { hits.load(), misses.load(), invalidations.load(), entries };
+}
@@ -0,0 +1,247 @@
+#ifndef FD_CACHE_HPP
+#define FD_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <http/validators.hpp>
+#include <cache/opener.hpp>
+
+namespace cache {
+  /**
+   * An open file shared between the cache and the responses sending it. The descriptor
+   * is closed when the last reference goes away.
+   */
+  struct OpenFile {
+    int fd;
+    off_t size;
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+
+    /**
+     * The content type to send with the file
+     */
+    std::string content_type;
+
+    /**
+     * The ETag and Last-Modified values, formatted when the file was opened
+     */
+    http::Validators validators;
+
+    /**
+     * Which of the cache's sidecar suffixes exist next to the file, one bit each
+     */
+    unsigned sidecars;
+
+    OpenFile() : fd(-1), size(0), dev(0), ino(0), mtime(), content_type(), validators(), sidecars(0) {
+    }
+
+    ~OpenFile();
+
+    OpenFile(const OpenFile&) = delete;
+    OpenFile& operator=(const OpenFile&) = delete;
+  };
+
+  /**
+   * Counters describing how well the cache is doing
+   */
+  struct FdCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+    size_t entries;
+  };
+
+  /**
+   * A cache of open file descriptors and their stat data, so that serving a file
+   * needs no open(), stat() or close() in the steady state. The cache is split into
+   * shards with their own lock. Entries are invalidated through inotify watches on
+   * every directory from the root down to them, so that renaming or replacing any of
+   * those directories drops the files below it, and closed after being unused for a while.
+   */
+  class FdCache {
+    public:
+      typedef std::shared_ptr<const OpenFile> FilePtr;
+
+    protected:
+      typedef std::chrono::steady_clock clock;
+
+      static const size_t SHARD_COUNT = 16;
+
+      struct Entry {
+        FilePtr file;
+        clock::time_point used;
+      };
+
+      struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+      };
+
+      /**
+       * The maximum number of entries in each shard
+       */
+      size_t max_shard_entries;
+
+      /**
+       * How long an unused entry is kept open
+       */
+      clock::duration inactive;
+
+      /**
+       * The suffixes of sidecar files whose existence is kept with every entry. A change to
+       * a sidecar invalidates the file it belongs to.
+       */
+      std::vector<std::string> sidecars;
+
+      /**
+       * Opens the files on a miss
+       */
+      Opener opener;
+
+      /**
+       * The directory the cached paths are below, empty if unknown
+       */
+      std::string root;
+
+      /**
+       * The shards of the cache, chosen by a hash of the path
+       */
+      Shard shards[SHARD_COUNT];
+
+      /**
+       * The inotify instance, or -1 if inotify is not available
+       */
+      int inotify_fd;
+
+      /**
+       * Used to wake the watcher thread on shutdown
+       */
+      int wakeup_fd;
+
+      /**
+       * Mutex for the watch maps
+       */
+      std::mutex watch_mutex;
+
+      /**
+       * Maps inotify watch descriptors onto the directories they watch, stored as a
+       * list of NUL terminated spellings of the directory
+       */
+      std::map<int, std::string> watch_dirs;
+
+      /**
+       * Maps every spelling of a watched directory onto its watch descriptor
+       */
+      std::map<std::string, int> dir_watches;
+
+      /**
+       * The thread reading inotify events and closing inactive entries
+       */
+      std::thread watcher;
+
+      std::atomic<uint64_t> hits;
+      std::atomic<uint64_t> misses;
+      std::atomic<uint64_t> invalidations;
+
+      Shard& shard(const std::string& path);
+
+      /**
+       * Makes sure every directory from the root down to the path is watched
+       */
+      bool watch(const std::string& path);
+
+      /**
+       * Forgets the watches of a directory and of the directories below it, whose names
+       * may refer to other directories by now
+       * @param dir the directory
+       * @return true if any of them were watched
+       */
+      bool forget(const std::string& dir);
+
+      /**
+       * Removes a single path from the cache
+       */
+      void invalidate(const std::string& path);
+
+      /**
+       * Removes every path in a directory from the cache
+       */
+      void invalidateDirectory(const std::string& dir);
+
+      /**
+       * Closes entries that have not been used within the inactive timeout
+       */
+      void sweep();
+
+      /**
+       * The loop of the watcher thread
+       */
+      void run();
+
+    public:
+      /**
+       * Creates a new descriptor cache
+       * @param max_entries the maximum number of open files
+       * @param inactive_ms how long, in milliseconds, an unused file is kept open
+       * @param sidecars the suffixes of sidecar files to look for next to every file
+       */
+      FdCache(size_t max_entries, int inactive_ms, const std::vector<std::string>& sidecars);
+
+      /**
+       * Stops the watcher thread and closes every cached file that is not in use
+       */
+      ~FdCache();
+
+      /**
+       * Whether or not the cache can be used. It requires inotify.
+       * @return true if the cache is usable
+       */
+      bool usable() {
+        return inotify_fd != -1;
+      }
+
+      /**
+       * Sets how files are opened, by default by their path as it is. Must be called
+       * before the cache is used.
+       * @param opener the function to open files with
+       */
+      void setOpener(Opener opener);
+
+      /**
+       * Sets the directory the cached paths are below, which is watched along with every
+       * directory down to a cached file. Without it only the directory holding a file is.
+       * Must be called before the cache is used.
+       * @param root the directory, without trailing slashes
+       */
+      void setRoot(const std::string& root);
+
+      /**
+       * Returns the open file for a path, opening and caching it on a miss
+       * @param path the resolved path
+       * @param content_type the content type to store with a newly opened file
+       * @return the open file, or nullptr with errno set if the path can't be opened, ENOENT if
+       *         it is not a regular file
+       */
+      FilePtr get(const std::string& path, const char* content_type);
+
+      /**
+       * Returns the current counters of the cache
+       * @return the cache statistics
+       */
+      FdCacheStats stats();
+  };
+};
+#endif
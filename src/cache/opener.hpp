@@ -0,0 +1,23 @@
+#ifndef OPENER_HPP
+#define OPENER_HPP
+
+#include <string>
+#include <functional>
+
+#include <fcntl.h>
+
+namespace cache {
+  /**
+   * Opens a file for reading on behalf of a cache, so that cached and uncached lookups
+   * resolve paths alike. Returns the descriptor, or -1 with errno set.
+   */
+  typedef std::function<int(const std::string& path)> Opener;
+
+  /**
+   * Opens the path as it is
+   */
+  inline int open_path(const std::string& path) {
+    return open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  }
+};
+#endif
@@ -0,0 +1,30 @@
+#ifndef SIDECARS_HPP
+#define SIDECARS_HPP
+
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace cache {
+  /**
+   * Checks which sidecars of a file exist, such as the precompressed foo.js.gz next to foo.js
+   * @param path the path of the file
+   * @param suffixes the suffixes of the sidecars, at most 32
+   * @return a bit for every suffix, in order, that names a regular file
+   */
+  inline unsigned probe_sidecars(const std::string& path, const std::vector<std::string>& suffixes) {
+    unsigned found = 0;
+
+    for (size_t i = 0; i < suffixes.size(); i++) {
+      struct stat st;
+
+      if (stat((path + suffixes[i]).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+        found |= 1u << i;
+      }
+    }
+
+    return found;
+  }
+};
+#endif
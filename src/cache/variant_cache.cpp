@@ -0,0 +1,58 @@
+#include <cache/variant_cache.hpp>
+
+cache::VariantCache::VariantCache(size_t b) : max_bytes(b), mutex(), lru(), index(), used_bytes(0), hits(0),
+  misses(0), evictions(0) {
+}
+
+std::string cache::VariantCache::key(const std::string& path, const std::string& version, const char* variant) {
+  std::string k;
+  k.reserve(path.size() + version.size() + 16);
+  k.append(path).push_back('\0');
+  k.append(version).push_back('\0');
+  k.append(variant);
+  return k;
+}
+
+cache::VariantCache::BodyPtr cache::VariantCache::lookup(const std::string& key) {
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = index.find(key);
+
+  if (it == index.end()) {
+    misses++;
+    return nullptr;
+  }
+
+  lru.splice(lru.begin(), lru, it->second);
+  hits++;
+
+  return it->second->body;
+}
+
+void cache::VariantCache::insert(const std::string& key, BodyPtr body) {
+  if (!body || body->size() > max_bytes) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // another worker may have made the same variant in the meantime
+  if (index.find(key) != index.end()) {
+    return;
+  }
+
+  while (!lru.empty() && used_bytes + body->size() > max_bytes) {
+    used_bytes -= lru.back().body->size();
+    index.erase(lru.back().key);
+    lru.pop_back();
+    evictions++;
+  }
+
+  lru.push_front(Entry { key, body });
+  index[key] = lru.begin();
+  used_bytes += body->size();
+}
+
+cache::VariantCacheStats cache::VariantCache::stats() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return VariantCacheStats { hits.load(), misses.load(), evictions.load(), used_bytes, lru.size() };
+}
@@ -0,0 +1,105 @@
+#ifndef VARIANT_CACHE_HPP
+#define VARIANT_CACHE_HPP
+
+#include <string>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include <unordered_map>
+
+namespace cache {
+  /**
+   * Counters describing how well the cache is doing
+   */
+  struct VariantCacheStats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t bytes;
+    size_t entries;
+  };
+
+  /**
+   * A bounded cache of derived representations of files, such as their compressed forms.
+   * Keys name the file, its version and the kind of variant, so that a changed file never
+   * hits an old variant; outdated variants simply age out of the LRU list.
+   */
+  class VariantCache {
+    public:
+      typedef std::shared_ptr<const std::string> BodyPtr;
+
+    protected:
+      struct Entry {
+        std::string key;
+        BodyPtr body;
+      };
+
+      /**
+       * The maximum number of bytes held by the cache
+       */
+      size_t max_bytes;
+
+      /**
+       * Mutex for the LRU list and the index
+       */
+      std::mutex mutex;
+
+      /**
+       * The entries, most recently used first
+       */
+      std::list<Entry> lru;
+
+      /**
+       * Maps a key onto its entry in the LRU list
+       */
+      std::unordered_map<std::string, std::list<Entry>::iterator> index;
+
+      /**
+       * The number of bytes currently held
+       */
+      size_t used_bytes;
+
+      std::atomic<uint64_t> hits;
+      std::atomic<uint64_t> misses;
+      std::atomic<uint64_t> evictions;
+
+    public:
+      /**
+       * Creates a new variant cache
+       * @param max_bytes the memory budget of the cache
+       */
+      VariantCache(size_t max_bytes);
+
+      /**
+       * Builds the key of a variant
+       * @param path the path of the file
+       * @param version a string that changes whenever the file does, such as its ETag
+       * @param variant the kind of variant, such as "gzip"
+       * @return the key
+       */
+      static std::string key(const std::string& path, const std::string& version, const char* variant);
+
+      /**
+       * Looks up a variant
+       * @param key the key of the variant
+       * @return the variant, or nullptr on a miss
+       */
+      BodyPtr lookup(const std::string& key);
+
+      /**
+       * Stores a variant, evicting the least recently used ones to stay within budget
+       * @param key the key of the variant
+       * @param body the variant
+       */
+      void insert(const std::string& key, BodyPtr body);
+
+      /**
+       * Returns the current counters of the cache
+       * @return the cache statistics
+       */
+      VariantCacheStats stats();
+  };
+};
+#endif
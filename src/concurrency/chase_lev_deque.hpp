@@ -0,0 +1,164 @@
+#ifndef CHASE_LEV_DEQUE_HPP
+#define CHASE_LEV_DEQUE_HPP
+
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace concurrency {
+  /**
+   * A lock-free work-stealing deque (Chase and Lev, with the C11 memory orderings of
+   * Le et al.). The owning thread pushes and pops at the bottom, other threads steal
+   * from the top. The deque grows when full; old arrays are kept until it is destroyed,
+   * since a thief may still be reading from them.
+   */
+  template<class T>
+  class ChaseLevDeque {
+    protected:
+      struct Array {
+        int64_t capacity;
+        std::atomic<T>* items;
+
+        Array(int64_t c) : capacity(c), items(new std::atomic<T>[c]) {
+        }
+
+        ~Array() {
+          delete[] items;
+        }
+
+        T get(int64_t i) {
+          return items[i & (capacity - 1)].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t i, T x) {
+          items[i & (capacity - 1)].store(x, std::memory_order_relaxed);
+        }
+      };
+
+      alignas(64) std::atomic<int64_t> top;
+      alignas(64) std::atomic<int64_t> bottom;
+      std::atomic<Array*> array;
+
+      /**
+       * Arrays replaced by a grow, only touched by the owner
+       */
+      std::vector<Array*> retired;
+
+      Array* grow(Array* a, int64_t t, int64_t b) {
+        Array* bigger = new Array(a->capacity * 2);
+
+        for (int64_t i = t; i < b; i++) {
+          bigger->put(i, a->get(i));
+        }
+
+        retired.push_back(a);
+        array.store(bigger, std::memory_order_release);
+        return bigger;
+      }
+
+    public:
+      /**
+       * Creates a new deque
+       * @param capacity the initial capacity, a power of two
+       */
+      ChaseLevDeque(int64_t capacity) : top(0), bottom(0), array(new Array(capacity)), retired() {
+      }
+
+      ~ChaseLevDeque() {
+        delete array.load();
+
+        for (Array* a : retired) {
+          delete a;
+        }
+      }
+
+      /**
+       * Pushes an item at the bottom. Must only be called by the owner.
+       * @param x the item
+       */
+      void push(T x) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        Array* a = array.load(std::memory_order_relaxed);
+
+        if (b - t > a->capacity - 1) {
+          a = grow(a, t, b);
+        }
+
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+      }
+
+      /**
+       * Pops the most recently pushed item. Must only be called by the owner.
+       * @param x where to store the item, left alone if there is none
+       * @return false if the deque is empty
+       */
+      bool pop(T& x) {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        Array* a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+          bottom.store(b + 1, std::memory_order_relaxed);
+          return false;
+        }
+
+        T item = a->get(b);
+
+        if (t == b) {
+          // the last item, race the thieves for it; a thief that wins has it
+          bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+          bottom.store(b + 1, std::memory_order_relaxed);
+
+          if (!won) {
+            return false;
+          }
+        }
+
+        x = item;
+        return true;
+      }
+
+      /**
+       * Steals the oldest item. Safe to call from any thread.
+       * @param x where to store the item, left alone if the steal fails
+       * @return false if the deque is empty or the steal lost a race
+       */
+      bool steal(T& x) {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+
+        if (t >= b) {
+          return false;
+        }
+
+        Array* a = array.load(std::memory_order_acquire);
+        T item = a->get(t);
+
+        // the item is only ours once top moved past it, until then the owner or another thief may take it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+          return false;
+        }
+
+        x = item;
+        return true;
+      }
+
+      /**
+       * Returns the approximate number of items
+       * @return the number of items
+       */
+      size_t size() {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+      }
+  };
+};
+#endif
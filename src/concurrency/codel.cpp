@@ -0,0 +1,63 @@
+#include <concurrency/codel.hpp>
+
+#include <cmath>
+
+concurrency::CoDel::CoDel() : target(0), interval(0), first_above(0), drop_next(0), count(0), dropping(false) {
+}
+
+void concurrency::CoDel::configure(std::chrono::nanoseconds t, std::chrono::nanoseconds i) {
+  target = t.count();
+  interval = i.count();
+}
+
+int64_t concurrency::CoDel::controlLaw(int64_t t, uint32_t n) {
+  return t + (int64_t)(interval / std::sqrt((double)(n > 0 ? n : 1)));
+}
+
+bool concurrency::CoDel::shouldShed(clock::time_point enqueued, clock::time_point n) {
+  if (target <= 0) {
+    return false;
+  }
+
+  int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(n.time_since_epoch()).count();
+  int64_t sojourn = std::chrono::duration_cast<std::chrono::nanoseconds>(n - enqueued).count();
+
+  if (sojourn < target) {
+    first_above.store(0, std::memory_order_relaxed);
+    dropping.store(false, std::memory_order_relaxed);
+    return false;
+  }
+
+  int64_t above = first_above.load(std::memory_order_relaxed);
+
+  if (above == 0) {
+    first_above.store(now + interval, std::memory_order_relaxed);
+    return false;
+  }
+
+  if (now < above) {
+    return false;
+  }
+
+  if (!dropping.load(std::memory_order_relaxed)) {
+    // start shedding, close to the old rate if we were shedding not long ago
+    uint32_t c = count.load(std::memory_order_relaxed);
+    int64_t next = drop_next.load(std::memory_order_relaxed);
+    c = (c > 2 && now - next < 16 * interval) ? c - 2 : 1;
+
+    count.store(c, std::memory_order_relaxed);
+    drop_next.store(controlLaw(now, c), std::memory_order_relaxed);
+    dropping.store(true, std::memory_order_relaxed);
+    return true;
+  }
+
+  int64_t next = drop_next.load(std::memory_order_relaxed);
+
+  if (now >= next) {
+    uint32_t c = count.fetch_add(1, std::memory_order_relaxed) + 1;
+    drop_next.store(controlLaw(next, c), std::memory_order_relaxed);
+    return true;
+  }
+
+  return false;
+}
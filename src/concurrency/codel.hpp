@@ -0,0 +1,71 @@
+#ifndef CODEL_HPP
+#define CODEL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace concurrency {
+  /**
+   * The CoDel (controlled delay) queue management algorithm of Nichols and Jacobson,
+   * applied to task queues. It looks at how long each task sat in the queue, and once
+   * that delay has stayed above the target for a whole interval, it starts shedding tasks
+   * at an increasing rate until the delay drops below the target again.
+   *
+   * The state is kept in relaxed atomics, so several workers may consult it at once.
+   * Races only make the shedding rate slightly less precise.
+   */
+  class CoDel {
+    public:
+      typedef std::chrono::steady_clock clock;
+
+    protected:
+      /**
+       * The acceptable queue delay, in nanoseconds. 0 disables shedding.
+       */
+      int64_t target;
+
+      /**
+       * The time the delay must stay above the target before shedding starts
+       */
+      int64_t interval;
+
+      /**
+       * When the delay went above the target plus the interval, or 0 if it is below
+       */
+      std::atomic<int64_t> first_above;
+
+      /**
+       * When the next task should be shed
+       */
+      std::atomic<int64_t> drop_next;
+
+      /**
+       * The number of tasks shed in the current shedding period
+       */
+      std::atomic<uint32_t> count;
+
+      std::atomic<bool> dropping;
+
+      int64_t controlLaw(int64_t t, uint32_t n);
+
+    public:
+      CoDel();
+
+      /**
+       * Sets the target delay and the interval
+       * @param target the acceptable queue delay, 0 to disable shedding
+       * @param interval the time the delay may stay above the target
+       */
+      void configure(std::chrono::nanoseconds target, std::chrono::nanoseconds interval);
+
+      /**
+       * Decides whether a task that is being dequeued should be shed
+       * @param enqueued when the task was queued
+       * @param now the current time
+       * @return true if the task should be shed
+       */
+      bool shouldShed(clock::time_point enqueued, clock::time_point now);
+  };
+};
+#endif
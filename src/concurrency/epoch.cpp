@@ -0,0 +1,100 @@
+#include <concurrency/epoch.hpp>
+
+#include <new>
+#include <cstdlib>
+
+std::atomic<uint64_t> concurrency::Epochs::global(1);
+std::mutex concurrency::Epochs::mutex;
+std::vector<concurrency::Epochs::Slot*> concurrency::Epochs::slots;
+std::vector<std::pair<uint64_t, std::function<void()>>> concurrency::Epochs::retired;
+
+/**
+ * How deep the calling thread is in nested read sections
+ */
+static thread_local int depth = 0;
+
+concurrency::Epochs::Slot& concurrency::Epochs::local() {
+  static thread_local Slot* slot = nullptr;
+
+  if (!slot) {
+    // operator new only guarantees the alignment of fundamental types before C++17
+    void* memory = nullptr;
+
+    if (posix_memalign(&memory, alignof(Slot), sizeof(Slot)) != 0) {
+      throw std::bad_alloc();
+    }
+
+    slot = new(memory) Slot();
+    slot->epoch.store(0);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    slots.push_back(slot);
+  }
+
+  return *slot;
+}
+
+void concurrency::Epochs::enter() {
+  // an inner section is covered by the epoch of the outer one
+  if (depth++ > 0) {
+    return;
+  }
+
+  // sequentially consistent, so that a reader either announced an epoch the writer will
+  // wait for, or loads the pointer after it was replaced
+  local().epoch.store(global.load());
+}
+
+void concurrency::Epochs::leave() {
+  if (--depth > 0) {
+    return;
+  }
+
+  local().epoch.store(0, std::memory_order_release);
+}
+
+void concurrency::Epochs::retire(std::function<void()> deleter) {
+  uint64_t epoch = global.fetch_add(1);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  retired.push_back(std::make_pair(epoch, deleter));
+}
+
+size_t concurrency::Epochs::collect() {
+  std::vector<std::function<void()>> freeable;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // the oldest epoch a reader is still in
+    uint64_t oldest = UINT64_MAX;
+
+    for (Slot* slot : slots) {
+      uint64_t epoch = slot->epoch.load();
+
+      if (epoch != 0 && epoch < oldest) {
+        oldest = epoch;
+      }
+    }
+
+    // readers in the epoch an object was retired in may still hold it
+    auto it = retired.begin();
+
+    while (it != retired.end()) {
+      if (it->first < oldest) {
+        freeable.push_back(it->second);
+        it = retired.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // deleters may take time, such as a cache closing its files, so they run unlocked
+  for (auto& deleter : freeable) {
+    deleter();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  return retired.size();
+}
@@ -0,0 +1,134 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <utility>
+#include <cstdint>
+
+namespace concurrency {
+  /**
+   * Epoch-based reclamation. Readers announce the global epoch while they hold pointers to
+   * shared objects; an object that has been unpublished is retired with the epoch of its
+   * removal and only freed once every thread has either left its read section or entered
+   * a later epoch, so that no reader can still hold it.
+   *
+   * Entering and leaving a read section is a store to a slot of the calling thread, which
+   * no other thread writes. Nested sections are part of the outermost one. A section must
+   * not span a hand-off to another thread: a request handed to a worker is a new read
+   * section there.
+   */
+  class Epochs {
+    protected:
+      /**
+       * The epoch a thread is reading in, 0 when it is not reading, on a cache line of its own
+       */
+      struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch;
+      };
+
+      static std::atomic<uint64_t> global;
+
+      /**
+       * Guards the slots and the retired objects
+       */
+      static std::mutex mutex;
+      static std::vector<Slot*> slots;
+
+      /**
+       * Objects waiting to be freed, with the epoch they were retired in
+       */
+      static std::vector<std::pair<uint64_t, std::function<void()>>> retired;
+
+      static Slot& local();
+
+    public:
+      /**
+       * Starts a read section on the calling thread
+       */
+      static void enter();
+
+      /**
+       * Ends the read section of the calling thread
+       */
+      static void leave();
+
+      /**
+       * Retires an object that has been unpublished, so that no new reader can find it
+       * @param deleter frees the object, run once no reader holds it
+       */
+      static void retire(std::function<void()> deleter);
+
+      /**
+       * Frees the retired objects no reader can hold any more. Must not be called in a read section.
+       * @return the number of objects still waiting
+       */
+      static size_t collect();
+  };
+
+  /**
+   * Holds a read section for its lifetime
+   */
+  class EpochGuard {
+    public:
+      EpochGuard() {
+        Epochs::enter();
+      }
+
+      ~EpochGuard() {
+        Epochs::leave();
+      }
+
+      EpochGuard(const EpochGuard&) = delete;
+      EpochGuard& operator=(const EpochGuard&) = delete;
+  };
+
+  /**
+   * A pointer to an immutable object that is replaced as a whole, read-copy-update style:
+   * readers load it in a read section and use it for as long as the section lasts, while
+   * a writer publishes a new object and retires the old one.
+   */
+  template<class T> class Rcu {
+    protected:
+      std::atomic<T*> current;
+
+    public:
+      Rcu() : current(nullptr) {
+      }
+
+      /**
+       * Frees the current object. No reader may be left.
+       */
+      ~Rcu() {
+        delete current.load();
+      }
+
+      Rcu(const Rcu&) = delete;
+      Rcu& operator=(const Rcu&) = delete;
+
+      /**
+       * Returns the current object. Must be called in a read section, which the object
+       * is valid for.
+       */
+      T* get() const {
+        return current.load();
+      }
+
+      /**
+       * Publishes a new object and retires the previous one. Writers must not race.
+       * @param next the object, owned by this pointer from now on
+       */
+      void publish(T* next) {
+        T* previous = current.exchange(next);
+
+        if (previous) {
+          Epochs::retire([previous] {
+            delete previous;
+          });
+        }
+      }
+  };
+};
+#endif
@@ -0,0 +1,31 @@
+#include <concurrency/executor.hpp>
+
+/**
+ * Whether the task running on this thread is being shed
+ */
+static thread_local bool shedding_task = false;
+
+concurrency::Executor::Executor() : overflow(Overflow::BLOCK), codel(), rejected(0), dropped(0), shed(0) {
+}
+
+bool concurrency::Executor::shedding() {
+  return shedding_task;
+}
+
+void concurrency::Executor::execute(QueuedTask& t) {
+  if (codel.shouldShed(t.enqueued, CoDel::clock::now())) {
+    shed.fetch_add(1, std::memory_order_relaxed);
+    shedding_task = true;
+  }
+
+  t.task();
+  shedding_task = false;
+}
+
+void concurrency::Executor::discard(QueuedTask& t) {
+  dropped.fetch_add(1, std::memory_order_relaxed);
+
+  shedding_task = true;
+  t.task();
+  shedding_task = false;
+}
@@ -0,0 +1,204 @@
+#ifndef EXECUTOR_HPP
+#define EXECUTOR_HPP
+
+#include <functional>
+#include <utility>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <concurrency/task.hpp>
+#include <concurrency/codel.hpp>
+
+namespace concurrency {
+  /**
+   * What to do with a task when the queue is full
+   */
+  enum class Overflow {
+    /**
+     * Refuse the new task, push() returns false
+     */
+    REJECT,
+
+    /**
+     * Wait until there is room again
+     */
+    BLOCK,
+
+    /**
+     * Shed the oldest queued task to make room
+     */
+    DROP_OLDEST
+  };
+
+  /**
+   * A task together with the time it was queued
+   */
+  struct QueuedTask {
+    Task task;
+    CoDel::clock::time_point enqueued;
+
+    QueuedTask() : task(), enqueued() {
+    }
+
+    QueuedTask(Task&& t) : task(std::move(t)), enqueued(CoDel::clock::now()) {
+    }
+  };
+
+  /**
+   * Load and admission counters of an executor
+   */
+  struct ExecutorStats {
+    size_t queued;
+    int active;
+    uint64_t rejected;
+    uint64_t dropped;
+    uint64_t shed;
+  };
+
+  /**
+   * An Executor runs tasks on a set of worker threads. It is the common interface of
+   * the different schedulers, so that the server does not care which one it uses.
+   *
+   * Executors bound their queue and shed load when it backs up: tasks that were dropped
+   * to make room, or that waited longer than CoDel allows, still run, but with shedding()
+   * returning true, so that they can answer cheaply instead of doing their work.
+   */
+  class Executor {
+    protected:
+      /**
+       * What to do when the queue is full
+       */
+      Overflow overflow;
+
+      /**
+       * Decides which tasks have waited too long
+       */
+      CoDel codel;
+
+      /**
+       * Tasks refused because the queue was full
+       */
+      std::atomic<uint64_t> rejected;
+
+      /**
+       * Tasks dropped from a full queue to make room for newer ones
+       */
+      std::atomic<uint64_t> dropped;
+
+      /**
+       * Tasks shed because they waited too long
+       */
+      std::atomic<uint64_t> shed;
+
+      /**
+       * Hands a task to the scheduler
+       * @param task the task to run
+       * @return false if the task was rejected
+       */
+      virtual bool submit(Task task) = 0;
+
+      /**
+       * Hands a task to the scheduler with a hint of what it works on, so that schedulers
+       * able to can run the tasks of one key on the same workers. Ignores the key by default.
+       * @param task the task to run
+       * @param key what the task works on
+       * @return false if the task was rejected
+       */
+      virtual bool submitFor(Task task, uint64_t key) {
+        return submit(std::move(task));
+      }
+
+      /**
+       * Runs a dequeued task, shedding it if it waited too long
+       * @param t the task
+       */
+      void execute(QueuedTask& t);
+
+      /**
+       * Runs a task that was dropped from a full queue
+       * @param t the task
+       */
+      void discard(QueuedTask& t);
+
+    public:
+      Executor();
+
+      virtual ~Executor() {
+      }
+
+      /**
+       * Starts the worker threads
+       */
+      virtual void start() = 0;
+
+      /**
+       * Shuts down all worker threads.
+       */
+      virtual void shutdown() = 0;
+
+      /**
+       * Returns the queue depth and the admission counters
+       * @return the statistics
+       */
+      virtual ExecutorStats stats() = 0;
+
+      /**
+       * Sets what to do when the queue is full
+       * @param o the overflow policy
+       */
+      void setOverflow(Overflow o) {
+        overflow = o;
+      }
+
+      /**
+       * Enables CoDel shedding of tasks that wait too long
+       * @param target the acceptable queue delay, 0 to disable shedding
+       * @param interval the time the delay may stay above the target
+       */
+      void setDelayTarget(std::chrono::milliseconds target, std::chrono::milliseconds interval) {
+        codel.configure(target, interval);
+      }
+
+      /**
+       * Returns whether or not the task running on this thread is being shed
+       * @return true if the task should answer cheaply instead of doing its work
+       */
+      static bool shedding();
+
+      /**
+       * Creates a new task from a function callback
+       * @param f the function
+       * @return false if the task was rejected because the queue is full
+       */
+      template<class F>
+      bool push(F&& f) {
+        return submit(Task(std::forward<F>(f)));
+      }
+
+      /**
+       * Creates a new task from a function callback that prefers the workers of a key
+       * @param key what the task works on, such as the connection of a request
+       * @param f the function
+       * @return false if the task was rejected because the queue is full
+       */
+      template<class F>
+      bool pushFor(uint64_t key, F&& f) {
+        return submitFor(Task(std::forward<F>(f)), key);
+      }
+
+      /**
+       * Creates a new task by supplying a function callback
+       * and arguments to send to that function.
+       * @param f the function
+       * @param args the arguments to send to the callback function
+       * @return false if the task was rejected because the queue is full
+       */
+      template<class F, class A, class ...Args>
+      bool push(F&& f, A&& a, Args&&... args) {
+        // the bound call is stored in the task itself, not in a std::function
+        return submit(Task(std::bind(std::forward<F>(f), std::forward<A>(a), std::forward<Args>(args)...)));
+      }
+  };
+};
+#endif
@@ -0,0 +1,132 @@
+#ifndef MPMC_QUEUE_HPP
+#define MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace concurrency {
+  /**
+   * A bounded lock-free multi-producer multi-consumer queue (Dmitry Vyukov's algorithm).
+   * Every slot carries a sequence number telling producers and consumers whose turn it is.
+   */
+  template<class T>
+  class MpmcQueue {
+    protected:
+      struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+      };
+
+      Cell* cells;
+      size_t mask;
+
+      alignas(64) std::atomic<size_t> enqueue_pos;
+      alignas(64) std::atomic<size_t> dequeue_pos;
+
+    public:
+      /**
+       * Creates a new queue
+       * @param capacity the capacity, rounded up to a power of two
+       */
+      MpmcQueue(size_t capacity) : cells(NULL), mask(0), enqueue_pos(0), dequeue_pos(0) {
+        size_t size = 2;
+        while (size < capacity) {
+          size <<= 1;
+        }
+
+        cells = new Cell[size];
+        mask = size - 1;
+
+        for (size_t i = 0; i < size; i++) {
+          cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+      }
+
+      ~MpmcQueue() {
+        delete[] cells;
+      }
+
+      MpmcQueue(const MpmcQueue&) = delete;
+      MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+      /**
+       * Pushes an item
+       * @param x the item
+       * @return false if the queue is full
+       */
+      bool push(const T& x) {
+        Cell* cell;
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+
+        while (true) {
+          cell = &cells[pos & mask];
+          size_t seq = cell->sequence.load(std::memory_order_acquire);
+          intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+          if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              break;
+            }
+          } else if (diff < 0) {
+            return false;
+          } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+          }
+        }
+
+        cell->data = x;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+
+      /**
+       * Pops the oldest item
+       * @param x where to store the item
+       * @return false if the queue is empty
+       */
+      bool pop(T& x) {
+        Cell* cell;
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+
+        while (true) {
+          cell = &cells[pos & mask];
+          size_t seq = cell->sequence.load(std::memory_order_acquire);
+          intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+          if (diff == 0) {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+              break;
+            }
+          } else if (diff < 0) {
+            return false;
+          } else {
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+          }
+        }
+
+        x = cell->data;
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+      }
+
+      /**
+       * Returns the approximate number of items
+       * @return the number of items
+       */
+      size_t size() {
+        size_t e = enqueue_pos.load(std::memory_order_relaxed);
+        size_t d = dequeue_pos.load(std::memory_order_relaxed);
+        return e > d ? e - d : 0;
+      }
+
+      /**
+       * Returns the capacity of the queue
+       * @return the capacity
+       */
+      size_t capacity() {
+        return mask + 1;
+      }
+  };
+};
+#endif
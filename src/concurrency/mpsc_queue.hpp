@@ -0,0 +1,99 @@
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+
+namespace concurrency {
+  /**
+   * A node that can be linked into a MpscQueue. Types stored in the queue
+   * must derive from it.
+   */
+  struct MpscNode {
+    std::atomic<MpscNode*> next;
+
+    MpscNode() : next(nullptr) {
+    }
+  };
+
+  /**
+   * An intrusive, unbounded, lock-free multi-producer single-consumer queue
+   * (Dmitry Vyukov's algorithm). Any thread may push, but only one thread may pop.
+   * The queue does not own its nodes.
+   */
+  template<class T>
+  class MpscQueue {
+    protected:
+      /**
+       * The most recently pushed node, shared by the producers
+       */
+      std::atomic<MpscNode*> head;
+
+      /**
+       * The oldest node, only touched by the consumer
+       */
+      MpscNode* tail;
+
+      /**
+       * Placeholder node that keeps the queue non-empty
+       */
+      MpscNode stub;
+
+      void pushNode(MpscNode* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        MpscNode* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+      }
+
+    public:
+      MpscQueue() : head(&stub), tail(&stub), stub() {
+      }
+
+      /**
+       * Pushes a node onto the queue. Safe to call from any thread.
+       * @param node the node to push
+       */
+      void push(T* node) {
+        pushNode(node);
+      }
+
+      /**
+       * Pops the oldest node off the queue. Must only be called by the consumer.
+       * @return the node, or nullptr if the queue is empty or a push is still in progress
+       */
+      T* pop() {
+        MpscNode* t = tail;
+        MpscNode* next = t->next.load(std::memory_order_acquire);
+
+        if (t == &stub) {
+          if (!next) {
+            return nullptr;
+          }
+
+          tail = next;
+          t = next;
+          next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next) {
+          tail = next;
+          return static_cast<T*>(t);
+        }
+
+        // a producer has swapped the head, but not linked it in yet
+        if (t != head.load(std::memory_order_acquire)) {
+          return nullptr;
+        }
+
+        pushNode(&stub);
+        next = t->next.load(std::memory_order_acquire);
+
+        if (next) {
+          tail = next;
+          return static_cast<T*>(t);
+        }
+
+        return nullptr;
+      }
+  };
+};
+#endif
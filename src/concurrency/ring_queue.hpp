@@ -0,0 +1,75 @@
+#ifndef RING_QUEUE_HPP
+#define RING_QUEUE_HPP
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace concurrency {
+  /**
+   * A FIFO queue on a ring buffer that only grows. Unlike std::queue it does not allocate
+   * or free memory as items come and go, once it has grown to its working size.
+   * Not thread safe.
+   */
+  template<class T>
+  class RingQueue {
+    protected:
+      std::vector<T> items;
+      size_t head;
+      size_t count;
+
+      void grow() {
+        std::vector<T> bigger(items.empty() ? 64 : items.size() * 2);
+
+        for (size_t i = 0; i < count; i++) {
+          bigger[i] = std::move(items[(head + i) % items.size()]);
+        }
+
+        items.swap(bigger);
+        head = 0;
+      }
+
+    public:
+      RingQueue() : items(), head(0), count(0) {
+      }
+
+      /**
+       * Appends an item
+       * @param x the item
+       */
+      void push(T&& x) {
+        if (count == items.size()) {
+          grow();
+        }
+
+        items[(head + count) % items.size()] = std::move(x);
+        count++;
+      }
+
+      /**
+       * Returns the oldest item
+       * @return the oldest item
+       */
+      T& front() {
+        return items[head];
+      }
+
+      /**
+       * Removes the oldest item
+       */
+      void pop() {
+        items[head] = T();
+        head = (head + 1) % items.size();
+        count--;
+      }
+
+      size_t size() const {
+        return count;
+      }
+
+      bool empty() const {
+        return count == 0;
+      }
+  };
+};
+#endif
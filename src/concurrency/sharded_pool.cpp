@@ -0,0 +1,306 @@
+#include <concurrency/sharded_pool.hpp>
+
+#include <new>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+
+#include <pthread.h>
+#include <sched.h>
+
+/**
+ * The backlog per worker a shard may have before its tasks spill to a shorter queue
+ */
+static const size_t SPILL = 2;
+
+/**
+ * Returns the CPUs this process may run on, node by node as sysfs lists them
+ */
+static std::vector<int> cpus_by_node() {
+  std::vector<int> cpus;
+  cpu_set_t allowed;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+    return cpus;
+  }
+
+  for (int node = 0; ; node++) {
+    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+
+    if (!std::getline(in, list)) {
+      break;
+    }
+
+    // ranges such as "0-7,16-23"
+    size_t start = 0;
+
+    while (start < list.size()) {
+      size_t comma = list.find(',', start);
+      std::string range = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+      size_t dash = range.find('-');
+      int first = atoi(range.c_str());
+      int last = dash == std::string::npos ? first : atoi(range.c_str() + dash + 1);
+
+      for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+          cpus.push_back(cpu);
+        }
+      }
+
+      start = comma == std::string::npos ? list.size() : comma + 1;
+    }
+  }
+
+  // without NUMA information the CPUs are taken in order
+  if (cpus.empty()) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+
+  return cpus;
+}
+
+concurrency::ShardedPool::ShardedPool(size_t w, size_t n, size_t c, bool g, bool pin, const std::vector<int>& reserved)
+  : shards(), worker_count(w > 0 ? w : 1), threads(), stop(false), graceful_shutdown(g), capacity(0) {
+  size_t count = std::min(std::max(n, (size_t)1), worker_count);
+  std::vector<int> cpus;
+
+  if (pin) {
+    cpus = cpus_by_node();
+    std::vector<int> unreserved;
+
+    for (int cpu : cpus) {
+      if (std::find(reserved.begin(), reserved.end(), cpu) == reserved.end()) {
+        unreserved.push_back(cpu);
+      }
+    }
+
+    if (!unreserved.empty()) {
+      cpus.swap(unreserved);
+    }
+  }
+
+  // the capacity is split so that all shards together hold as many tasks as one queue would
+  if (c > 0) {
+    capacity = (c + count - 1) / count;
+  }
+
+  // the CPU of the first worker of the next shard
+  size_t next = 0;
+
+  for (size_t i = 0; i < count; i++) {
+    // operator new only guarantees the alignment of fundamental types before C++17
+    void* memory = nullptr;
+
+    if (posix_memalign(&memory, alignof(Shard), sizeof(Shard)) != 0) {
+      throw std::bad_alloc();
+    }
+
+    Shard* shard = new(memory) Shard();
+    shard->length.store(0);
+    shard->active.store(0);
+    shard->workers = worker_count / count + (i < worker_count % count ? 1 : 0);
+
+    // a shard takes the next CPUs in node order, one per worker, starting over once all are taken
+    for (size_t k = 0; k < shard->workers && !cpus.empty(); k++) {
+      int cpu = cpus[next++ % cpus.size()];
+
+      if (std::find(shard->cpus.begin(), shard->cpus.end(), cpu) == shard->cpus.end()) {
+        shard->cpus.push_back(cpu);
+      }
+    }
+
+    shards.push_back(shard);
+  }
+}
+
+concurrency::ShardedPool::~ShardedPool() {
+  if (!stop) {
+    shutdown();
+  }
+
+  for (Shard* shard : shards) {
+    shard->~Shard();
+    free(shard);
+  }
+}
+
+void concurrency::ShardedPool::start() {
+  for (Shard* shard : shards) {
+    for (size_t i = 0; i < shard->workers; i++) {
+      threads.emplace_back([this, shard] {
+        run(shard);
+      });
+    }
+  }
+}
+
+void concurrency::ShardedPool::run(Shard* shard) {
+  if (!shard->cpus.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+
+    for (int cpu : shard->cpus) {
+      CPU_SET(cpu, &set);
+    }
+
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  while (true) {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+
+    // wait as long as stop is false and queue is empty
+    while (!stop && shard->queue.size() == 0) {
+      shard->cond.wait(lock);
+    }
+
+    if (stop && (!graceful_shutdown || shard->queue.size() == 0)) {
+      break;
+    }
+
+    QueuedTask task(std::move(shard->queue.front()));
+    shard->queue.pop();
+    shard->length.store(shard->queue.size(), std::memory_order_relaxed);
+    lock.unlock();
+
+    if (capacity > 0 && overflow == Overflow::BLOCK) {
+      shard->not_full.notify_one();
+    }
+
+    shard->active.fetch_add(1, std::memory_order_relaxed);
+    execute(task);
+    shard->active.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void concurrency::ShardedPool::shutdown() {
+  stop = true;
+
+  for (Shard* shard : shards) {
+    // a worker that saw the flag unset is waiting by the time the lock is free
+    {
+      std::unique_lock<std::mutex> lock(shard->mutex);
+    }
+
+    shard->cond.notify_all();
+    shard->not_full.notify_all();
+  }
+
+  for (size_t i = 0; i < threads.size(); ++i) {
+    if (threads[i].joinable()) {
+      threads[i].join();
+    }
+  }
+}
+
+concurrency::ShardedPool::Shard* concurrency::ShardedPool::shortest() {
+  Shard* best = shards[0];
+  size_t best_length = best->length.load(std::memory_order_relaxed);
+
+  for (size_t i = 1; i < shards.size() && best_length > 0; i++) {
+    size_t length = shards[i]->length.load(std::memory_order_relaxed);
+
+    if (length < best_length) {
+      best = shards[i];
+      best_length = length;
+    }
+  }
+
+  return best;
+}
+
+bool concurrency::ShardedPool::submit(Task task) {
+  // every producer takes its own turns, so that they don't share a counter
+  static thread_local size_t turn = std::hash<std::thread::id>()(std::this_thread::get_id());
+
+  return submitFor(std::move(task), turn++);
+}
+
+bool concurrency::ShardedPool::submitFor(Task task, uint64_t key) {
+  if (stop) {
+    throw ThreadPoolException("push on stopped thread_pool");
+  }
+
+  // the low bits of keys such as pointers are all the same, multiplying mixes in the others
+  Shard* shard = shards[((key * 0x9E3779B97F4A7C15ULL) >> 32) % shards.size()];
+  size_t length = shard->length.load(std::memory_order_relaxed);
+
+  if (length > SPILL * shard->workers) {
+    Shard* other = shortest();
+
+    if (other->length.load(std::memory_order_relaxed) < length) {
+      shard = other;
+    }
+  }
+
+  return enqueue(shard, std::move(task));
+}
+
+bool concurrency::ShardedPool::enqueue(Shard* shard, Task task) {
+  QueuedTask oldest;
+  bool drop = false;
+
+  {
+    std::unique_lock<std::mutex> lock(shard->mutex);
+
+    if (capacity > 0 && shard->queue.size() >= capacity) {
+      if (overflow == Overflow::REJECT) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else if (overflow == Overflow::BLOCK) {
+        while (!stop && shard->queue.size() >= capacity) {
+          shard->not_full.wait(lock);
+        }
+
+        if (stop) {
+          rejected.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+      } else {
+        oldest = std::move(shard->queue.front());
+        shard->queue.pop();
+        drop = true;
+      }
+    }
+
+    shard->queue.push(QueuedTask(std::move(task)));
+    shard->length.store(shard->queue.size(), std::memory_order_relaxed);
+  }
+
+  shard->cond.notify_one();
+
+  // the dropped task gets to answer, outside the lock
+  if (drop) {
+    discard(oldest);
+  }
+
+  return true;
+}
+
+concurrency::ExecutorStats concurrency::ShardedPool::stats() {
+  ExecutorStats s;
+  s.queued = 0;
+  s.active = 0;
+
+  for (Shard* shard : shards) {
+    {
+      std::unique_lock<std::mutex> lock(shard->mutex);
+      s.queued += shard->queue.size();
+    }
+
+    s.active += shard->active.load();
+  }
+
+  s.rejected = rejected.load();
+  s.dropped = dropped.load();
+  s.shed = shed.load();
+
+  return s;
+}
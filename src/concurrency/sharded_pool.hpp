@@ -0,0 +1,169 @@
+#ifndef SHARDED_POOL_HPP
+#define SHARDED_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+#include <exceptions.hpp>
+#include <concurrency/executor.hpp>
+#include <concurrency/ring_queue.hpp>
+
+namespace concurrency {
+  /**
+   * A ShardedPool splits the workers into shards, each with a queue and a lock of its own,
+   * so that producers and workers of different shards never touch the same cache lines.
+   * Tasks pushed with a key always go to the same shard while it keeps up, which keeps
+   * what they work on warm in the caches of its cores; once a shard backs up, its tasks
+   * spill to the shard with the shortest queue.
+   *
+   * Pinned workers are laid out over the CPUs node by node, a CPU per worker as long as
+   * there are enough, and each shard is pinned to the CPUs of its workers. The workers of a
+   * shard so share a NUMA node, without sharing a CPU with each other or the event loops.
+   */
+  class ShardedPool : public Executor {
+    protected:
+      /**
+       * A queue with the workers serving it, on cache lines of its own
+       */
+      struct alignas(64) Shard {
+        std::mutex mutex;
+
+        /**
+         * Condition variable for when the queue is empty
+         */
+        std::condition_variable cond;
+
+        /**
+         * Condition variable for blocked producers, when the queue is full
+         */
+        std::condition_variable not_full;
+
+        RingQueue<QueuedTask> queue;
+
+        /**
+         * The length of the queue, read without the lock to pick a shard
+         */
+        std::atomic<size_t> length;
+
+        /**
+         * The number of workers executing a task
+         */
+        std::atomic<int> active;
+
+        /**
+         * The number of workers serving the queue
+         */
+        size_t workers;
+
+        /**
+         * The CPUs the workers are pinned to, empty if they are not
+         */
+        std::vector<int> cpus;
+      };
+
+      std::vector<Shard*> shards;
+
+      /**
+       * The number of workers over all shards
+       */
+      size_t worker_count;
+
+      std::vector<std::thread> threads;
+
+      /**
+       * Whether or not to stop the workers
+       */
+      std::atomic<bool> stop;
+
+      /**
+       * Whether or not the workers finish their queues on shutdown
+       */
+      bool graceful_shutdown;
+
+      /**
+       * The maximum number of queued tasks per shard, 0 for no limit
+       */
+      size_t capacity;
+
+      /**
+       * Runs the tasks of a shard until the pool stops
+       * @param shard the shard
+       */
+      void run(Shard* shard);
+
+      /**
+       * Returns the shard with the shortest queue
+       */
+      Shard* shortest();
+
+      /**
+       * Puts a task on the queue of the next shard, taking turns per producer
+       * @param task the task
+       * @return false if the queue is full and the task was rejected
+       */
+      bool submit(Task task);
+
+      /**
+       * Puts a task on the queue of the shard of its key, or of the shortest queue if that one backs up
+       * @param task the task
+       * @param key what the task works on
+       * @return false if the queue is full and the task was rejected
+       */
+      bool submitFor(Task task, uint64_t key);
+
+      /**
+       * Puts a task on the queue of a shard, applying the overflow policy if it is full
+       * @param shard the shard
+       * @param task the task
+       * @return false if the task was rejected
+       */
+      bool enqueue(Shard* shard, Task task);
+
+    public:
+      /**
+       * Creates a new sharded pool
+       * @param workers the number of workers
+       * @param shards the number of shards, at most one per worker
+       * @param capacity the maximum number of queued tasks, 0 for no limit, split over the shards
+       * @param graceful whether or not to do graceful shutdown
+       * @param pin whether or not to pin the workers of every shard to CPUs of their own
+       * @param reserved the CPUs the workers are kept off when pinned, such as those of the
+       *                 event loops, unless no other CPU is left
+       */
+      ShardedPool(size_t workers, size_t shards, size_t capacity, bool graceful, bool pin,
+        const std::vector<int>& reserved = std::vector<int>());
+
+      /**
+       * Stops all workers if they havent been stopped yet
+       */
+      ~ShardedPool();
+
+      /**
+       * Starts the workers
+       */
+      void start();
+
+      /**
+       * Shuts down all worker threads.
+       */
+      void shutdown();
+
+      /**
+       * Returns the queue depth over all shards and the admission counters
+       * @return the statistics
+       */
+      ExecutorStats stats();
+
+      /**
+       * Returns the number of shards
+       */
+      size_t shardCount() {
+        return shards.size();
+      }
+  };
+};
+#endif
@@ -0,0 +1,83 @@
+#include <concurrency/slab.hpp>
+
+#include <new>
+
+#include <concurrency/mpsc_queue.hpp>
+
+namespace {
+  struct Cache;
+
+  /**
+   * The header of a block, followed by BLOCK_SIZE bytes of data
+   */
+  struct alignas(16) Block : concurrency::MpscNode {
+    /**
+     * The cache the block belongs to
+     */
+    Cache* owner;
+
+    /**
+     * The next block on the free list of the owner
+     */
+    Block* next_free;
+  };
+
+  struct Cache {
+    /**
+     * Blocks freed by the owning thread
+     */
+    Block* free_list;
+
+    /**
+     * Blocks freed by other threads, drained by the owning thread
+     */
+    concurrency::MpscQueue<Block> returned;
+
+    Cache() : free_list(NULL), returned() {
+    }
+  };
+
+  thread_local Cache* local_cache = NULL;
+
+  Cache* cache() {
+    if (!local_cache) {
+      local_cache = new Cache();
+    }
+
+    return local_cache;
+  }
+}
+
+void* concurrency::Slab::allocate(size_t size) {
+  if (size > BLOCK_SIZE) {
+    return ::operator new(size);
+  }
+
+  Cache* c = cache();
+  Block* b = c->free_list;
+
+  if (b) {
+    c->free_list = b->next_free;
+  } else if ((b = c->returned.pop()) == NULL) {
+    b = new (::operator new(sizeof(Block) + BLOCK_SIZE)) Block();
+    b->owner = c;
+  }
+
+  return b + 1;
+}
+
+void concurrency::Slab::release(void* p, size_t size) {
+  if (size > BLOCK_SIZE) {
+    ::operator delete(p);
+    return;
+  }
+
+  Block* b = static_cast<Block*>(p) - 1;
+
+  if (b->owner == local_cache) {
+    b->next_free = b->owner->free_list;
+    b->owner->free_list = b;
+  } else {
+    b->owner->returned.push(b);
+  }
+}
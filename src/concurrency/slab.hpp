@@ -0,0 +1,38 @@
+#ifndef SLAB_HPP
+#define SLAB_HPP
+
+#include <cstddef>
+
+namespace concurrency {
+  /**
+   * A per-thread pool of fixed-size blocks for short-lived objects that are allocated on
+   * one thread and freed on another, such as tasks handed to a worker. Freed blocks go back
+   * to the cache of the thread that allocated them through a lock-free queue, so that
+   * producers and consumers reach a steady state without touching the heap.
+   *
+   * Thread caches are never freed, since blocks may be returned to them after their
+   * thread has exited.
+   */
+  class Slab {
+    public:
+      /**
+       * The size of a block. Larger allocations go to the heap.
+       */
+      static const size_t BLOCK_SIZE = 256;
+
+      /**
+       * Allocates memory, from the slab if it fits in a block
+       * @param size the number of bytes
+       * @return the memory
+       */
+      static void* allocate(size_t size);
+
+      /**
+       * Releases memory returned by allocate(). Safe to call from any thread.
+       * @param p the memory
+       * @param size the number of bytes passed to allocate()
+       */
+      static void release(void* p, size_t size);
+  };
+};
+#endif
@@ -0,0 +1,172 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <new>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+#include <concurrency/slab.hpp>
+
+namespace concurrency {
+  /**
+   * A move-only, type-erased task. Callables that fit in the inline buffer are stored
+   * in the task itself, larger ones in a block from the per-thread Slab, so creating,
+   * queueing and running a task does not touch the heap.
+   */
+  class Task {
+    public:
+      /**
+       * The size of the inline buffer, enough for a handful of pointers and a std::string
+       */
+      static const size_t INLINE_SIZE = 64;
+
+    protected:
+      struct Ops {
+        void (*invoke)(Task&);
+        void (*relocate)(Task& dst, Task& src);
+        void (*destroy)(Task&);
+      };
+
+      /**
+       * Operations on the stored callable, or NULL if the task is empty
+       */
+      const Ops* ops;
+
+      union {
+        /**
+         * The callable, if it is stored out of line
+         */
+        void* remote;
+
+        /**
+         * The callable, if it fits
+         */
+        std::aligned_storage<INLINE_SIZE, alignof(std::max_align_t)>::type storage;
+      };
+
+      template<class F>
+      struct Inline {
+        static F* get(Task& t) {
+          return reinterpret_cast<F*>(&t.storage);
+        }
+
+        static void invoke(Task& t) {
+          (*get(t))();
+        }
+
+        static void relocate(Task& dst, Task& src) {
+          new (&dst.storage) F(std::move(*get(src)));
+          get(src)->~F();
+        }
+
+        static void destroy(Task& t) {
+          get(t)->~F();
+        }
+
+        static const Ops ops;
+      };
+
+      template<class F>
+      struct Remote {
+        static F* get(Task& t) {
+          return static_cast<F*>(t.remote);
+        }
+
+        static void invoke(Task& t) {
+          (*get(t))();
+        }
+
+        static void relocate(Task& dst, Task& src) {
+          dst.remote = src.remote;
+        }
+
+        static void destroy(Task& t) {
+          get(t)->~F();
+          Slab::release(t.remote, sizeof(F));
+        }
+
+        static const Ops ops;
+      };
+
+      void reset() {
+        if (ops) {
+          ops->destroy(*this);
+          ops = NULL;
+        }
+      }
+
+    public:
+      Task() : ops(NULL) {
+      }
+
+      /**
+       * Creates a task from a callable
+       * @param f the callable, moved or copied into the task
+       */
+      template<class F, class D = typename std::decay<F>::type,
+        class = typename std::enable_if<!std::is_same<D, Task>::value>::type>
+      Task(F&& f) : ops(NULL) {
+        if (sizeof(D) <= INLINE_SIZE && alignof(D) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible<D>::value) {
+          new (&storage) D(std::forward<F>(f));
+          ops = &Inline<D>::ops;
+        } else {
+          remote = new (Slab::allocate(sizeof(D))) D(std::forward<F>(f));
+          ops = &Remote<D>::ops;
+        }
+      }
+
+      Task(Task&& other) : ops(other.ops) {
+        if (ops) {
+          ops->relocate(*this, other);
+          other.ops = NULL;
+        }
+      }
+
+      Task& operator=(Task&& other) {
+        if (this != &other) {
+          reset();
+          ops = other.ops;
+
+          if (ops) {
+            ops->relocate(*this, other);
+            other.ops = NULL;
+          }
+        }
+
+        return *this;
+      }
+
+      Task(const Task&) = delete;
+      Task& operator=(const Task&) = delete;
+
+      ~Task() {
+        reset();
+      }
+
+      /**
+       * Runs the task
+       */
+      void operator()() {
+        ops->invoke(*this);
+      }
+
+      /**
+       * Whether or not the task holds a callable
+       * @return true if the task can be run
+       */
+      explicit operator bool() const {
+        return ops != NULL;
+      }
+  };
+
+  template<class F>
+  const Task::Ops Task::Inline<F>::ops = { &Task::Inline<F>::invoke, &Task::Inline<F>::relocate,
+    &Task::Inline<F>::destroy };
+
+  template<class F>
+  const Task::Ops Task::Remote<F>::ops = { &Task::Remote<F>::invoke, &Task::Remote<F>::relocate,
+    &Task::Remote<F>::destroy };
+};
+#endif
@@ -1,18 +1,23 @@
 #include <concurrency/thread_pool.hpp>
 
 concurrency::ThreadPool::ThreadPool(size_t k, bool g)
-  : worker_count(k), workers(), active_workers(0), stop(false), graceful_shutdown(g), active_mutex(), queue_mutex(),
-    cond(), queue() {
+  : worker_count(k), workers(), active_workers(0), stop(false), graceful_shutdown(g), queue_mutex(),
+    cond(), not_full(), capacity(0), queue() {
+}
+
+concurrency::ThreadPool::ThreadPool(size_t k, size_t c, bool g)
+  : worker_count(k), workers(), active_workers(0), stop(false), graceful_shutdown(g), queue_mutex(),
+    cond(), not_full(), capacity(c), queue() {
 }
 
 concurrency::ThreadPool::ThreadPool(size_t k) : worker_count(k), workers(), active_workers(0), stop(false),
-  graceful_shutdown(false), active_mutex(), queue_mutex(),
-  cond(), queue() {
+  graceful_shutdown(false), queue_mutex(),
+  cond(), not_full(), capacity(0), queue() {
 }
 
 concurrency::ThreadPool::ThreadPool() : worker_count(5), workers(), active_workers(0), stop(false),
-  graceful_shutdown(false), active_mutex(), queue_mutex(),
-  cond(), queue() {
+  graceful_shutdown(false), queue_mutex(),
+  cond(), not_full(), capacity(0), queue() {
 }
 
 void concurrency::ThreadPool::start() {
@@ -38,12 +43,18 @@ void concurrency::ThreadPool::init(size_t k) {
           break;
         }
 
-        std::function<void()> task(queue.front());
+        QueuedTask task(std::move(queue.front()));
         queue.pop();
         lock.unlock();
 
+        if (capacity > 0 && overflow == Overflow::BLOCK) {
+          not_full.notify_one();
+        }
+
         // make a call to the callback which was set in push()
-        task();
+        active_workers++;
+        execute(task);
+        active_workers--;
       }
     });
   }
@@ -62,6 +73,7 @@ void::concurrency::ThreadPool::shutdown() {
   }
 
   cond.notify_all();
+  not_full.notify_all();
 
   for (size_t i = 0; i < workers.size(); ++i) {
     if (workers[i].joinable()) {
@@ -69,3 +81,63 @@ void::concurrency::ThreadPool::shutdown() {
     }
   }
 }
+
+bool concurrency::ThreadPool::submit(Task task) {
+  if (stop) {
+    throw ThreadPoolException("push on stopped thread_pool");
+  }
+
+  QueuedTask oldest;
+  bool drop = false;
+
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+
+    if (capacity > 0 && queue.size() >= capacity) {
+      if (overflow == Overflow::REJECT) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      } else if (overflow == Overflow::BLOCK) {
+        while (!stop && queue.size() >= capacity) {
+          not_full.wait(lock);
+        }
+
+        if (stop) {
+          rejected.fetch_add(1, std::memory_order_relaxed);
+          return false;
+        }
+      } else {
+        oldest = std::move(queue.front());
+        queue.pop();
+        drop = true;
+      }
+    }
+
+    queue.push(QueuedTask(std::move(task)));
+  }
+
+  cond.notify_one();
+
+  // the dropped task gets to answer, outside the lock
+  if (drop) {
+    discard(oldest);
+  }
+
+  return true;
+}
+
+concurrency::ExecutorStats concurrency::ThreadPool::stats() {
+  ExecutorStats s;
+
+  {
+    std::unique_lock<std::mutex> lock(queue_mutex);
+    s.queued = queue.size();
+  }
+
+  s.active = active_workers.load();
+  s.rejected = rejected.load();
+  s.dropped = dropped.load();
+  s.shed = shed.load();
+
+  return s;
+}
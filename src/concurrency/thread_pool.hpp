@@ -3,20 +3,24 @@
 
 #include <vector>
 #include <thread>
-#include <queue>
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
 #include <sstream>
+#include <functional>
 #include <memory>
 
 #include <exceptions.hpp>
+#include <concurrency/executor.hpp>
+#include <concurrency/ring_queue.hpp>
 
 namespace concurrency {
   /**
    * A ThreadPool is a manager of workers. It is responsible of starting a specified amount of worker
-   * threads, as well as feeding them with work.
+   * threads, as well as feeding them with work. The queue is unbounded unless the pool is given
+   * a capacity, in which case the overflow policy decides what happens to new tasks.
    */
-  class ThreadPool {
+  class ThreadPool : public Executor {
     protected:
       /**
        * The number of workers initiated
@@ -32,7 +36,7 @@ namespace concurrency {
        * The number of active workers, that is the amount of worker threads that are
        * executing a work function
        */
-      int active_workers;
+      std::atomic<int> active_workers;
 
       /**
        * Whether or not to stop the workers
@@ -44,11 +48,6 @@ namespace concurrency {
        */
       bool graceful_shutdown;
 
-      /**
-       * Mutex for active_workers
-       */
-      std::mutex active_mutex;
-
       /**
        * Mutex for stop flag and the work queue
        */
@@ -59,10 +58,27 @@ namespace concurrency {
        */
       std::condition_variable cond;
 
+      /**
+       * Condition variable for blocked producers, when the queue is full
+       */
+      std::condition_variable not_full;
+
+      /**
+       * The maximum number of queued tasks, 0 for no limit
+       */
+      size_t capacity;
+
       /**
        * The queue of work functions
        */
-      std::queue<std::function<void()>> queue;
+      RingQueue<QueuedTask> queue;
+
+      /**
+       * Puts a task on the queue
+       * @param task the task
+       * @return false if the queue is full and the task was rejected
+       */
+      bool submit(Task task);
 
     private:
       void init(size_t);
@@ -76,6 +92,14 @@ namespace concurrency {
        */
       ThreadPool(size_t, bool);
 
+      /**
+       * Creates a new thread pool with a bounded queue
+       * @param workers the number of workers
+       * @param capacity the maximum number of queued tasks, 0 for no limit
+       * @param graceful whether or not to do graceful shutdown
+       */
+      ThreadPool(size_t workers, size_t capacity, bool graceful);
+
       /**
        * Creates a new thread pool with a specified amount of workers. Graceful shutdown
        * is set to false.
@@ -109,39 +133,10 @@ namespace concurrency {
       void shutdown();
 
       /**
-       * Creates a new task on the queue by supplying a function callback
-       * and optional arguments to send to that function.
-       * @param f the function
-       * @param args the arguments to send to the callback function
+       * Returns the queue depth and the admission counters
+       * @return the statistics
        */
-      template<class F, class ...Args>
-      void push(F&& f, Args&&... args) {
-        if (stop) {
-          throw ThreadPoolException("push on stopped thread_pool");
-        }
-
-        // unpack arguments and bind them to the function
-        std::function<void()> task = std::bind(f, args...);
-
-        {
-          std::unique_lock<std::mutex> lock(queue_mutex);
-          queue.push([this, task] {
-            {
-              std::lock_guard<std::mutex> lock(this->active_mutex);
-              this->active_workers++;
-            }
-
-            task();
-
-            {
-              std::lock_guard<std::mutex> lock(this->active_mutex);
-              this->active_workers--;
-            }
-          });
-        }
-
-        cond.notify_one();
-      }
+      ExecutorStats stats();
 
       /**
        * Returns whether or not the workers should quit
@@ -0,0 +1,247 @@
+#include <concurrency/work_stealing_pool.hpp>
+
+#include <climits>
+#include <new>
+
+#include <concurrency/slab.hpp>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/**
+ * The number of rounds an idle worker looks for work before parking
+ */
+static const int SPIN_ROUNDS = 64;
+
+/**
+ * The pool and worker the current thread belongs to, if any
+ */
+static thread_local concurrency::WorkStealingPool* current_pool = NULL;
+static thread_local void* current_worker = NULL;
+
+static void futex_wait(std::atomic<uint32_t>* word, uint32_t expected) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t>* word, int count) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+
+/**
+ * Tasks are queued as pointers, to nodes taken from the slab of the submitting thread
+ */
+static concurrency::QueuedTask* new_task(concurrency::Task&& task) {
+  return new (concurrency::Slab::allocate(sizeof(concurrency::QueuedTask))) concurrency::QueuedTask(std::move(task));
+}
+
+static void delete_task(concurrency::QueuedTask* task) {
+  task->~QueuedTask();
+  concurrency::Slab::release(task, sizeof(concurrency::QueuedTask));
+}
+
+static uint64_t xorshift(uint64_t& state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+concurrency::WorkStealingPool::WorkStealingPool(size_t k, size_t capacity, bool g)
+  : worker_count(k > 0 ? k : 1), graceful_shutdown(g), workers(), injection(capacity), stop(false), active_workers(0),
+    epoch(0), sleepers(0) {
+}
+
+concurrency::WorkStealingPool::~WorkStealingPool() {
+  if (!stop) {
+    shutdown();
+  }
+
+  for (Worker* w : workers) {
+    delete w;
+  }
+}
+
+void concurrency::WorkStealingPool::start() {
+  for (size_t i = 0; i < worker_count; i++) {
+    workers.push_back(new Worker(0x9E3779B97F4A7C15ULL * (i + 1)));
+  }
+
+  for (Worker* w : workers) {
+    w->thread = std::thread([this, w] {
+      run(w);
+    });
+  }
+}
+
+void concurrency::WorkStealingPool::shutdown() {
+  stop = true;
+  epoch.fetch_add(1);
+  futex_wake(&epoch, INT_MAX);
+
+  for (Worker* w : workers) {
+    if (w->thread.joinable()) {
+      w->thread.join();
+    }
+  }
+
+  // whatever is left was dropped
+  TaskPtr task;
+  while (injection.pop(task)) {
+    delete_task(task);
+  }
+
+  for (Worker* w : workers) {
+    while (w->deque.pop(task)) {
+      delete_task(task);
+    }
+  }
+}
+
+bool concurrency::WorkStealingPool::submit(Task f) {
+  if (stop) {
+    throw ThreadPoolException("push on stopped thread_pool");
+  }
+
+  TaskPtr task = new_task(std::move(f));
+
+  if (current_pool == this) {
+    // workers keep their own tasks, where they are cheap to pop and can be stolen
+    static_cast<Worker*>(current_worker)->deque.push(task);
+  } else {
+    while (!injection.push(task)) {
+      if (overflow == Overflow::REJECT) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        delete_task(task);
+        return false;
+      }
+
+      TaskPtr oldest;
+
+      if (overflow == Overflow::DROP_OLDEST && injection.pop(oldest)) {
+        discard(*oldest);
+        delete_task(oldest);
+        continue;
+      }
+
+      // the injection queue is full, let the workers catch up
+      wake();
+      std::this_thread::yield();
+
+      if (stop) {
+        rejected.fetch_add(1, std::memory_order_relaxed);
+        delete_task(task);
+        return false;
+      }
+    }
+  }
+
+  wake();
+  return true;
+}
+
+void concurrency::WorkStealingPool::wake() {
+  if (sleepers.load() > 0) {
+    epoch.fetch_add(1);
+    futex_wake(&epoch, 1);
+  }
+}
+
+bool concurrency::WorkStealingPool::next(Worker* w, TaskPtr& task) {
+  if (w->deque.pop(task) || injection.pop(task)) {
+    return true;
+  }
+
+  size_t n = workers.size();
+  size_t start = xorshift(w->seed) % n;
+
+  for (size_t i = 0; i < n; i++) {
+    Worker* victim = workers[(start + i) % n];
+
+    if (victim != w && victim->deque.steal(task)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void concurrency::WorkStealingPool::run(Worker* w) {
+  current_pool = this;
+  current_worker = w;
+
+  TaskPtr task = NULL;
+
+  while (true) {
+    if (stop && !graceful_shutdown) {
+      break;
+    }
+
+    bool found = false;
+
+    // only a task found in this round is ours to run
+    task = NULL;
+
+    for (int i = 0; i < SPIN_ROUNDS && !found; i++) {
+      found = next(w, task);
+    }
+
+    if (!found) {
+      if (stop) {
+        break;
+      }
+
+      // announce that we are about to park, then look once more, so that a
+      // submit racing with us either sees the sleeper or leaves us a task
+      uint32_t e = epoch.load();
+      sleepers.fetch_add(1);
+
+      if (!stop && !next(w, task)) {
+        futex_wait(&epoch, e);
+        sleepers.fetch_sub(1);
+        continue;
+      }
+
+      sleepers.fetch_sub(1);
+
+      if (stop && !graceful_shutdown) {
+        break;
+      }
+
+      if (!task) {
+        continue;
+      }
+    }
+
+    active_workers.fetch_add(1, std::memory_order_relaxed);
+    execute(*task);
+    active_workers.fetch_sub(1, std::memory_order_relaxed);
+
+    delete_task(task);
+  }
+
+  current_pool = NULL;
+  current_worker = NULL;
+}
+
+size_t concurrency::WorkStealingPool::queueLength() {
+  size_t n = injection.size();
+
+  for (Worker* w : workers) {
+    n += w->deque.size();
+  }
+
+  return n;
+}
+
+concurrency::ExecutorStats concurrency::WorkStealingPool::stats() {
+  ExecutorStats s;
+
+  s.queued = queueLength();
+  s.active = active_workers.load(std::memory_order_relaxed);
+  s.rejected = rejected.load();
+  s.dropped = dropped.load();
+  s.shed = shed.load();
+
+  return s;
+}
@@ -0,0 +1,141 @@
+#ifndef WORK_STEALING_POOL_HPP
+#define WORK_STEALING_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <cstdint>
+
+#include <exceptions.hpp>
+#include <concurrency/executor.hpp>
+#include <concurrency/chase_lev_deque.hpp>
+#include <concurrency/mpmc_queue.hpp>
+
+namespace concurrency {
+  /**
+   * A lock-free work-stealing scheduler. Every worker owns a Chase-Lev deque for the tasks
+   * it submits itself, while other threads submit through a bounded MPMC injection queue.
+   * A worker out of work steals from a random other worker, spins for a while and then
+   * parks on a futex until a new task arrives. The capacity of the injection queue is the
+   * limit the overflow policy applies to.
+   */
+  class WorkStealingPool : public Executor {
+    protected:
+      typedef QueuedTask* TaskPtr;
+
+      struct Worker {
+        ChaseLevDeque<TaskPtr> deque;
+        std::thread thread;
+
+        /**
+         * State of the random number generator used to pick victims
+         */
+        uint64_t seed;
+
+        Worker(uint64_t s) : deque(256), thread(), seed(s) {
+        }
+      };
+
+      /**
+       * The number of workers initiated
+       */
+      size_t worker_count;
+
+      /**
+       * Flag to indicate that whether or not the workers should finish the queue on shutdown or not
+       */
+      bool graceful_shutdown;
+
+      /**
+       * The workers and their deques
+       */
+      std::vector<Worker*> workers;
+
+      /**
+       * The queue for tasks submitted by threads outside the pool
+       */
+      MpmcQueue<TaskPtr> injection;
+
+      /**
+       * Whether or not to stop the workers
+       */
+      std::atomic<bool> stop;
+
+      /**
+       * The number of workers executing a task
+       */
+      std::atomic<int> active_workers;
+
+      /**
+       * Bumped whenever parked workers should wake up. Used as the futex word.
+       */
+      alignas(64) std::atomic<uint32_t> epoch;
+
+      /**
+       * The number of parked, or about to park, workers
+       */
+      std::atomic<int> sleepers;
+
+      bool submit(Task task);
+
+      /**
+       * Finds the next task for a worker: its own deque, the injection queue, then a steal
+       */
+      bool next(Worker* w, TaskPtr& task);
+
+      /**
+       * The loop of a worker thread
+       */
+      void run(Worker* w);
+
+      /**
+       * Wakes a parked worker, if there is one
+       */
+      void wake();
+
+    public:
+      /**
+       * Creates a new work-stealing pool
+       * @param workers the number of workers
+       * @param capacity the capacity of the injection queue
+       * @param graceful whether or not to finish queued tasks on shutdown
+       */
+      WorkStealingPool(size_t workers, size_t capacity, bool graceful);
+
+      /**
+       * Stops all workers if they havent been stopped yet
+       */
+      ~WorkStealingPool();
+
+      /**
+       * Starts the worker threads
+       */
+      void start();
+
+      /**
+       * Shuts down all worker threads, dropping queued tasks unless the shutdown is graceful
+       */
+      void shutdown();
+
+      /**
+       * Returns the number of workers executing a task
+       * @return the number of busy workers
+       */
+      int activeWorkers() {
+        return active_workers.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Returns the approximate number of queued tasks
+       * @return the number of queued tasks
+       */
+      size_t queueLength();
+
+      /**
+       * Returns the queue depth and the admission counters
+       * @return the statistics
+       */
+      ExecutorStats stats();
+  };
+};
+#endif
@@ -89,6 +89,9 @@ int config::CommandlineOptions::parse(config::Configurator* cfg, int argc, char*
   // don't let getopt() print error messages
   //opterr = 0;
 
+  // the command line is parsed again when the configuration is reloaded
+  optind = 1;
+
   int c;
   std::string parsed_opts = getOptionString();
   const char* optstring = parsed_opts.c_str();
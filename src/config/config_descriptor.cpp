@@ -1,13 +1,18 @@
 #include <config/config_descriptor.hpp>
 
 void config::ConfigDescriptor::add(std::string name, bool required) {
-  keys.insert(std::make_pair(name, required));
+  add(name, required, Type::STRING);
 }
 
 void config::ConfigDescriptor::add(std::string name) {
   add(name, false);
 }
 
+void config::ConfigDescriptor::add(std::string name, bool required, Type type, long min, long max) {
+  Setting setting = { required, type, min, max };
+  keys.insert(std::make_pair(name, setting));
+}
+
 void config::ConfigDescriptor::verify(std::vector<std::pair<ConfigSource*, int>> sources) {
   if (!keys.size()) {
     return;
@@ -15,7 +20,7 @@ void config::ConfigDescriptor::verify(std::vector<std::pair<ConfigSource*, int>>
 
   for (auto it = begin(keys); it != end(keys); ++it) {
     std::string val = it->first;
-    bool required = it->second;
+    bool required = it->second.required;
     bool found = false;
 
     if (!required) {
@@ -40,3 +45,7 @@ void config::ConfigDescriptor::verify(std::vector<std::pair<ConfigSource*, int>>
 bool config::ConfigDescriptor::hasKey(std::string name) {
   return keys.find(name) != keys.end();
 }
+
+const std::map<std::string, config::Setting>& config::ConfigDescriptor::getSettings() const {
+  return keys;
+}
@@ -5,22 +5,53 @@
 #include <map>
 #include <utility>
 #include <vector>
+#include <climits>
 
 #include <exceptions.hpp>
 #include <config/config_source.hpp>
 
 namespace config {
+  /**
+   * The type a configuration value must have
+   */
+  enum class Type {
+    STRING,
+
+    /**
+     * "true", "false", "1" or "0"
+     */
+    BOOL,
+
+    /**
+     * A decimal integer within a range
+     */
+    INT
+  };
+
+  /**
+   * Describes a configuration key
+   */
+  struct Setting {
+    bool required;
+    Type type;
+
+    /**
+     * The range an integer must be in, inclusive
+     */
+    long min;
+    long max;
+  };
+
   /**
    * The ConfigDescriptor is meant to describe which configuration values are
-   * required by the application.
+   * required by the application, and which type they have.
    */
   class ConfigDescriptor {
     protected:
       /**
-       * The map storing the configuration keys, and a bool stating it is required
-       * or not
+       * The map storing the configuration keys and their descriptions
        */
-      std::map<std::string, bool> keys;
+      std::map<std::string, Setting> keys;
     public:
       /**
        * Adds a new required configuration key
@@ -35,6 +66,16 @@ namespace config {
        */
       void add(std::string name);
 
+      /**
+       * Adds a new configuration key of a type
+       * @param name the configuration key
+       * @param required whether or not the configuration key is required
+       * @param type the type of its value
+       * @param min the smallest value an integer may have
+       * @param max the largest value an integer may have
+       */
+      void add(std::string name, bool required, Type type, long min = INT_MIN, long max = INT_MAX);
+
       /**
        * Verifies that all the required configuration keys has got values
        * @param sources a vector containing the different configuration sources
@@ -47,6 +88,12 @@ namespace config {
        * @return true if the key exists, false otherwise
        */
       bool hasKey(std::string name);
+
+      /**
+       * Returns the described configuration keys
+       * @return the keys and their descriptions
+       */
+      const std::map<std::string, Setting>& getSettings() const;
   };
 };
 #endif
@@ -48,7 +48,7 @@ int config::ConfigFile::parse(Configurator* cfg, int argc, char** argv) {
       if (configLib.lookupValue(pair.first, strval)) {
         setValue(pair.second, std::string(strval));
       } else if (configLib.lookupValue(pair.first, intval)) {
-        char buffer[10];
+        char buffer[12];
         int k = sprintf(buffer, "%d", intval);
         setValue(pair.second, std::string(buffer, k));
       } else if (configLib.lookupValue(pair.first, boolval)) {
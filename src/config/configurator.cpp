@@ -1,5 +1,9 @@
 #include <config/configurator.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
 int config::Priority::HIGHEST = 10;
 int config::Priority::HIGH = 5;
 int config::Priority::LOWEST = 0;
@@ -31,40 +35,115 @@ void config::Configurator::setDescriptor(ConfigDescriptor descriptor) {
   desc = descriptor;
 }
 
-bool config::Configurator::hasValue(std::string path) {
+config::ConfigSource* config::Configurator::find(const std::string& path) {
   for (auto it = priorities.begin(); it != priorities.end(); ++it) {
     ConfigSource* src = (*it).first;
 
     if (src->hasValue(path)) {
-      return true;
+      return src;
     }
   }
 
-  return false;
+  return NULL;
 }
 
-std::string config::Configurator::getString(std::string path) {
-  for (auto it = priorities.begin(); it != priorities.end(); ++it) {
-    ConfigSource* src = (*it).first;
+/**
+ * Converts a value to an integer in a range
+ */
+static int to_int(const std::string& path, const std::string& text, long min, long max) {
+  const char* start = text.c_str();
+  char* end = NULL;
 
-    if (src->hasValue(path)) {
-      return src->getValue(path);
+  errno = 0;
+  long number = strtol(start, &end, 10);
+
+  if (text.empty() || *end != '\0' || errno == ERANGE || number < min || number > max) {
+    throw InvalidSettingException("Invalid value \"" + text + "\" for " + path + ", expected an integer from "
+      + std::to_string(min) + " to " + std::to_string(max));
+  }
+
+  return (int)number;
+}
+
+/**
+ * Converts a value to a bool
+ */
+static bool to_bool(const std::string& path, const std::string& text) {
+  if (text == "true" || text == "1") {
+    return true;
+  }
+
+  if (text == "false" || text == "0") {
+    return false;
+  }
+
+  throw InvalidSettingException("Invalid value \"" + text + "\" for " + path + ", expected true or false");
+}
+
+void config::Configurator::compile() {
+  for (auto& setting : desc.getSettings()) {
+    ConfigSource* src = find(setting.first);
+
+    // verify() has made sure that required keys have a value
+    if (!src) {
+      continue;
     }
+
+    Value value = { src->getValue(setting.first), setting.second.type, 0, false };
+
+    if (value.type == Type::INT) {
+      value.number = to_int(setting.first, value.text, setting.second.min, setting.second.max);
+    } else if (value.type == Type::BOOL) {
+      value.flag = to_bool(setting.first, value.text);
+    }
+
+    values.insert(std::make_pair(setting.first, value));
+  }
+}
+
+bool config::Configurator::hasValue(std::string path) {
+  return values.count(path) > 0 || find(path) != NULL;
+}
+
+std::string config::Configurator::getString(std::string path) {
+  auto it = values.find(path);
+
+  if (it != values.end()) {
+    return it->second.text;
+  }
+
+  ConfigSource* src = find(path);
+
+  if (src) {
+    return src->getValue(path);
   }
 
   throw SettingNotFoundException("No source has bound to the key <" + path + ">, or has values for it!");
 }
 
 int config::Configurator::getInt(std::string path) {
-  return atoi(getString(path).c_str());
+  auto it = values.find(path);
+
+  if (it != values.end() && it->second.type == Type::INT) {
+    return it->second.number;
+  }
+
+  return to_int(path, getString(path), INT_MIN, INT_MAX);
 }
 
 bool config::Configurator::getBool(std::string path) {
-  std::string val = getString(path);
-  return val == "true" || val == "1";
+  auto it = values.find(path);
+
+  if (it != values.end() && it->second.type == Type::BOOL) {
+    return it->second.flag;
+  }
+
+  return to_bool(path, getString(path));
 }
 
 int config::Configurator::parse(int argc, char** argv) {
+  values.clear();
+
   for (auto it = priorities.begin(); it != priorities.end(); ++it) {
     ConfigSource* src = (*it).first;
 
@@ -75,29 +154,12 @@ int config::Configurator::parse(int argc, char** argv) {
 
   desc.verify(priorities);
 
-  // sort high to low
-  int len = priorities.size();
-  for (int i = 0; i < len - 1; ++i) {
-    bool sort_done = true;
-
-    for (int j = 0; j < len - 1 - i; ++j) {
-      int p = priorities[j].second;
-      int q = priorities[j + 1].second;
-
-      if (p < q) {
-        std::pair<ConfigSource*, int> t = priorities[j + 1];
-
-        priorities[j + 1] = priorities[j];
-        priorities[j] = t;
-
-        sort_done = false;
-      }
-    }
-
-    if (sort_done) {
-      break;
-    }
-  }
+  // sort high to low, sources of the same priority keep the order they were added in
+  std::stable_sort(priorities.begin(), priorities.end(),
+    [](const std::pair<ConfigSource*, int>& a, const std::pair<ConfigSource*, int>& b) {
+      return a.second > b.second;
+    });
 
+  compile();
   return 0;
 }
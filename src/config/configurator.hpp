@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 #include <typeinfo>
 
 #include <exceptions.hpp>
@@ -32,9 +33,24 @@ namespace config {
           static int LOWEST;
   };
 
+  /**
+   * A configuration value, converted once to the type of its key
+   */
+  struct Value {
+    std::string text;
+    Type type;
+    int number;
+    bool flag;
+  };
+
   /**
    * The configuration class is responsible for parsing sources, searching for values
    * and returning their values.
+   *
+   * Parsing resolves every key of the descriptor by priority, converts its value to the
+   * type of the key and checks it, so that a bad value is reported at startup. Looking
+   * a described key up afterwards is a hash lookup; other keys are searched for in the
+   * sources as they are asked for.
    */
   class Configurator {
     protected:
@@ -48,6 +64,24 @@ namespace config {
        * priority
        */
       std::vector<std::pair<ConfigSource*, int>> priorities;
+
+      /**
+       * The values of the described keys, resolved and converted by parse()
+       */
+      std::unordered_map<std::string, Value> values;
+
+      /**
+       * Returns the source with the highest priority that has a value for a key
+       * @param path the configuration key
+       * @return the source, or NULL if none has a value
+       */
+      ConfigSource* find(const std::string& path);
+
+      /**
+       * Resolves and converts the values of the described keys
+       * @throw InvalidSettingException if a value does not have the type of its key
+       */
+      void compile();
     public:
       /**
        * Creates a configuration object
@@ -89,6 +123,7 @@ namespace config {
        * @param argc the argument count
        * @param argv the argument vector
        * @return 0 if everything when OK, 1 otherwise
+       * @throw InvalidSettingException if a value does not have the type of its key
        */
       int parse(int argc, char** argv);
 
@@ -110,13 +145,15 @@ namespace config {
        * Returns a configuration value as an int
        * @param path the configuration key
        * @return the configuration value
+       * @throw InvalidSettingException if the value is not an integer
        */
       int getInt(std::string path);
 
       /**
        * Returns a configuration value as a bool
        * @param path the configuration key
-       * @return true if the configuration value equals "true" or "1", false otherwise
+       * @return true if the configuration value equals "true" or "1", false if it equals "false" or "0"
+       * @throw InvalidSettingException if the value is neither
        */
       bool getBool(std::string path);
   };
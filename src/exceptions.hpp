@@ -119,6 +119,15 @@ class RequiredSettingNotFoundException : public SettingNotFoundException {
     }
 };
 
+class InvalidSettingException : public ParseException {
+  public:
+    InvalidSettingException(std::string msg) : ParseException(msg) {
+    }
+
+    InvalidSettingException(int err, std::string msg) : ParseException(err, msg) {
+    }
+};
+
 class ConfigurationException : public BaseException {
   public:
     ConfigurationException(std::string msg) : BaseException(msg) {
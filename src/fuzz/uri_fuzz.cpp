@@ -0,0 +1,153 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+
+#include <http/uri.hpp>
+
+/**
+ * Fuzz target for the URI normalizer. Built with -DUSE_LIBFUZZER and -fsanitize=fuzzer it is
+ * a libFuzzer target; otherwise it comes with a small driver that replays the files given on
+ * the command line, or mutates a built-in corpus for a number of rounds.
+ *
+ * Every input is checked for the properties the file handler relies on: the path starts
+ * with a slash, holds no empty, "." or ".." segments, no NUL, is no longer than the input,
+ * comes out the same when normalized in place, and, unless decoding produced a '%', '?'
+ * or '#', is left alone by a second pass.
+ */
+
+static void fail(const char* what, const uint8_t* data, size_t size) {
+  std::cerr << "normalize_path: " << what << " for input \"";
+  std::cerr.write((const char*)data, size);
+  std::cerr << "\"" << std::endl;
+  abort();
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  std::vector<char> out(size + 1);
+  ssize_t n = http::normalize_path((const char*)data, size, out.data());
+
+  if (n < 0) {
+    return 0;
+  }
+
+  if ((size_t)n > size) {
+    fail("path longer than the input", data, size);
+  }
+
+  if (n < 1 || out[0] != '/' || out[n] != '\0') {
+    fail("path does not start with a slash or is not terminated", data, size);
+  }
+
+  if (memchr(out.data(), '\0', n)) {
+    fail("NUL in the path", data, size);
+  }
+
+  // every segment but a trailing empty one must be a name
+  for (ssize_t start = 1; start <= n; ) {
+    const char* slash = (const char*)memchr(out.data() + start, '/', n - start);
+    ssize_t end = slash ? slash - out.data() : n;
+    ssize_t len = end - start;
+
+    if ((len == 0 && end != n) || (len == 1 && out[start] == '.')
+        || (len == 2 && out[start] == '.' && out[start + 1] == '.')) {
+      fail("empty or dot segment left in the path", data, size);
+    }
+
+    start = end + 1;
+  }
+
+  std::vector<char> in_place((const char*)data, (const char*)data + size);
+  in_place.push_back('\0');
+
+  if (http::normalize_path(in_place.data(), size, in_place.data()) != n || memcmp(in_place.data(), out.data(), n)) {
+    fail("normalizing in place differs", data, size);
+  }
+
+  if (!memchr(out.data(), '%', n) && !memchr(out.data(), '?', n) && !memchr(out.data(), '#', n)) {
+    std::vector<char> again(n + 1);
+
+    if (http::normalize_path(out.data(), n, again.data()) != n || memcmp(again.data(), out.data(), n)) {
+      fail("normalizing twice changes the path", data, size);
+    }
+  }
+
+  return 0;
+}
+
+#ifndef USE_LIBFUZZER
+static const char* corpus[] = {
+  "/",
+  "/index.html",
+  "/a/b/../c/./d//e",
+  "/../../etc/passwd",
+  "/%2e%2e/%2E%2e/etc/passwd",
+  "/a%2fb",
+  "/a%00b",
+  "/%zz",
+  "/caf%C3%A9.html?lang=fr#top",
+  "http://example.com/a/../b?x=1",
+  "https://example.com",
+  "*",
+  "/a/b/c/../../../../",
+  "/.hidden/./..",
+  "//double//slashes///",
+  "/%",
+  "/%2",
+};
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "-rounds") != 0) {
+    for (int i = 1; i < argc; i++) {
+      std::ifstream file(argv[i], std::ios::binary);
+      std::stringstream data;
+      data << file.rdbuf();
+      std::string input = data.str();
+      LLVMFuzzerTestOneInput((const uint8_t*)input.data(), input.size());
+    }
+
+    std::cout << "replayed " << argc - 1 << " inputs" << std::endl;
+    return 0;
+  }
+
+  long rounds = argc > 2 ? atol(argv[2]) : 1000000;
+  const char alphabet[] = "/.%2eEfF0aA?#:";
+  std::mt19937 random(1234);
+
+  for (long i = 0; i < rounds; i++) {
+    std::string input = corpus[random() % (sizeof(corpus) / sizeof(corpus[0]))];
+    int mutations = 1 + random() % 8;
+
+    for (int m = 0; m < mutations; m++) {
+      size_t pos = input.empty() ? 0 : random() % (input.size() + 1);
+
+      switch (random() % 4) {
+        case 0:
+          input.insert(pos, 1, alphabet[random() % (sizeof(alphabet) - 1)]);
+          break;
+        case 1:
+          input.insert(pos, 1, (char)(random() % 256));
+          break;
+        case 2:
+          if (pos < input.size()) {
+            input.erase(pos, 1);
+          }
+          break;
+        default:
+          input.insert(pos, random() % 2 ? "/.." : "%2e");
+          break;
+      }
+    }
+
+    LLVMFuzzerTestOneInput((const uint8_t*)input.data(), input.size());
+  }
+
+  std::cout << rounds << " rounds without a failure" << std::endl;
+  return 0;
+}
+#endif
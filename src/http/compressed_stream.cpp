@@ -0,0 +1,130 @@
+#include <http/compressed_stream.hpp>
+
+#include <vector>
+
+#include <unistd.h>
+
+#include <event2/buffer.h>
+
+#include <http/response.hpp>
+#include <metrics/registry.hpp>
+
+size_t http::CompressedStream::chunk = 64 * 1024;
+
+/**
+ * The buffer file chunks are read into. A step runs to completion on the loop
+ * thread, so every stream of a thread can share one.
+ */
+static thread_local std::vector<char> input;
+
+void http::CompressedStream::configure(size_t c) {
+  chunk = c > 0 ? c : 64 * 1024;
+}
+
+http::CompressedStream::CompressedStream(struct evhttp_request* r, int f, off_t l, std::shared_ptr<const void> o,
+  Compressor* c) : req(r), evcon(evhttp_request_get_connection(r)), fd(f), owner(o), offset(0), length(l),
+    compressor(c), finished(false) {
+}
+
+http::CompressedStream::~CompressedStream() {
+  Compressor::release(compressor);
+}
+
+bool http::CompressedStream::start(struct evhttp_request* req, int status, const std::string& reason, int fd,
+    off_t length, std::shared_ptr<const void> owner) {
+  // a detached request has no client left to stream to, and is ours to free
+  if (!evhttp_request_get_connection(req)) {
+    evhttp_send_reply_end(req);
+    return true;
+  }
+
+  Compressor* compressor = Compressor::acquire();
+
+  if (!compressor) {
+    evhttp_send_error(req, HTTP_INTERNAL, "Internal Server Error");
+    return false;
+  }
+
+  // without a Content-Length, evhttp sends the body chunked
+  evhttp_send_reply_start(req, status, reason.c_str());
+
+  CompressedStream* stream = new CompressedStream(req, fd, length, owner, compressor);
+  evhttp_connection_set_closecb(stream->evcon, close_cb, stream);
+  stream->fill();
+  return true;
+}
+
+void http::CompressedStream::fill() {
+  if (finished) {
+    finish(false);
+    return;
+  }
+
+  if (input.size() < chunk) {
+    input.resize(chunk);
+  }
+
+  struct evbuffer* buf = evbuffer_new();
+
+  // deflate holds on to its input until it has enough, keep feeding it until it lets go
+  while (evbuffer_get_length(buf) == 0 && !finished) {
+    off_t n = length - offset < (off_t)chunk ? length - offset : (off_t)chunk;
+    ssize_t r = 0;
+
+    if (n > 0) {
+      r = pread(fd, &input[0], n, offset);
+
+      if (r <= 0) {
+        // the file can't be read, there is no way to recover after the headers went out
+        evbuffer_free(buf);
+        finish(true);
+        return;
+      }
+
+      offset += r;
+    }
+
+    finished = offset >= length;
+
+    if (!compressor->write(&input[0], r, finished, buf)) {
+      evbuffer_free(buf);
+      finish(true);
+      return;
+    }
+  }
+
+  metrics::Registry::countBytes(evbuffer_get_length(buf));
+  evhttp_send_reply_chunk_with_cb(req, buf, written_cb, this);
+  evbuffer_free(buf);
+}
+
+void http::CompressedStream::finish(bool aborted) {
+  // before the end of the reply, which may complete the request right away
+  evhttp_connection_set_closecb(evcon, NULL, NULL);
+  Response::release(evcon, aborted);
+
+  if (aborted) {
+    evhttp_connection_free(evcon);
+  } else {
+    evhttp_send_reply_end(req);
+  }
+
+  delete this;
+}
+
+void http::CompressedStream::written_cb(struct evhttp_connection*, void* arg) {
+  static_cast<CompressedStream*>(arg)->fill();
+}
+
+void http::CompressedStream::close_cb(struct evhttp_connection* evcon, void* arg) {
+  CompressedStream* stream = static_cast<CompressedStream*>(arg);
+
+  // the client went away. If evhttp detached the request it is ours to free,
+  // otherwise it is freed along with the connection.
+  if (!evhttp_request_get_connection(stream->req)) {
+    evhttp_send_reply_end(stream->req);
+  }
+
+  Response::release(evcon, true);
+  delete stream;
+}
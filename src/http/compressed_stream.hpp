@@ -0,0 +1,95 @@
+#ifndef COMPRESSED_STREAM_HPP
+#define COMPRESSED_STREAM_HPP
+
+#include <string>
+#include <memory>
+
+#include <sys/types.h>
+
+#include <event2/http.h>
+
+#include <http/compressor.hpp>
+
+namespace http {
+  /**
+   * A CompressedStream gzips a file while sending it. The file is read and compressed one
+   * chunk at a time, and the next chunk is only read once the connection has written the
+   * previous one, so neither the file nor its compressed form is ever held in memory.
+   * The compressed length is not known upfront, so the reply is sent chunked.
+   *
+   * Like a FileStream, a stream lives on the event loop thread and deletes itself when it
+   * is done or when the connection closes.
+   */
+  class CompressedStream {
+    protected:
+      /**
+       * The number of file bytes read and compressed per step
+       */
+      static size_t chunk;
+
+      struct evhttp_request* req;
+      struct evhttp_connection* evcon;
+
+      /**
+       * The file being sent, kept open by the owner
+       */
+      int fd;
+      std::shared_ptr<const void> owner;
+
+      /**
+       * The next offset to read, and the end of the file
+       */
+      off_t offset;
+      off_t length;
+
+      /**
+       * The compressor of this stream, taken from the loop thread's free list
+       */
+      Compressor* compressor;
+
+      /**
+       * Whether or not the end of the compressed stream has been queued
+       */
+      bool finished;
+
+      CompressedStream(struct evhttp_request* req, int fd, off_t length, std::shared_ptr<const void> owner,
+        Compressor* compressor);
+
+      ~CompressedStream();
+
+      /**
+       * Compresses and queues the next chunk, or ends the reply if everything has been written
+       */
+      void fill();
+
+      /**
+       * Ends the reply and deletes the stream
+       */
+      void finish(bool aborted);
+
+      static void written_cb(struct evhttp_connection*, void*);
+      static void close_cb(struct evhttp_connection*, void*);
+
+    public:
+      /**
+       * Sets the chunk size. Must be called before any stream is started.
+       * @param chunk the number of file bytes compressed per step
+       */
+      static void configure(size_t chunk);
+
+      /**
+       * Starts streaming a compressed file as the reply to a request. The status and headers,
+       * Content-Encoding included, must already be set. Must be called on the event loop thread.
+       * @param req the request
+       * @param status the status code
+       * @param reason the reason phrase
+       * @param fd the file to send
+       * @param length the number of bytes of the file
+       * @param owner keeps the file open until the stream is done
+       * @return false if no compressor was free and an error was sent instead
+       */
+      static bool start(struct evhttp_request* req, int status, const std::string& reason, int fd, off_t length,
+        std::shared_ptr<const void> owner);
+  };
+};
+#endif
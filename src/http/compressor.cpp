@@ -0,0 +1,110 @@
+#include <http/compressor.hpp>
+
+#include <cstring>
+
+int http::Compressor::level = Z_DEFAULT_COMPRESSION;
+
+/**
+ * The free compressors of the current thread
+ */
+static thread_local http::Compressor* free_list = NULL;
+
+/**
+ * Bytes reserved in the output buffer for every deflate() call
+ */
+static const size_t OUTPUT_STEP = 16384;
+
+http::Compressor::Compressor() : zs(), ready(false), next(NULL) {
+  memset(&zs, 0, sizeof(zs));
+
+  // 16 added to the window bits selects the gzip wrapper
+  ready = deflateInit2(&zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+}
+
+http::Compressor::~Compressor() {
+  if (ready) {
+    deflateEnd(&zs);
+  }
+}
+
+void http::Compressor::configure(int l) {
+  level = l;
+}
+
+http::Compressor* http::Compressor::acquire() {
+  Compressor* c = free_list;
+
+  if (c) {
+    free_list = c->next;
+    c->next = NULL;
+    deflateReset(&c->zs);
+    return c;
+  }
+
+  c = new Compressor();
+
+  if (!c->ready) {
+    delete c;
+    return NULL;
+  }
+
+  return c;
+}
+
+void http::Compressor::release(Compressor* c) {
+  c->next = free_list;
+  free_list = c;
+}
+
+bool http::Compressor::write(const char* data, size_t size, bool finish, struct evbuffer* out) {
+  zs.next_in = (Bytef*)data;
+  zs.avail_in = size;
+
+  int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+
+  while (true) {
+    struct evbuffer_iovec vec;
+
+    if (evbuffer_reserve_space(out, OUTPUT_STEP, &vec, 1) < 1) {
+      return false;
+    }
+
+    zs.next_out = (Bytef*)vec.iov_base;
+    zs.avail_out = vec.iov_len;
+
+    int ret = deflate(&zs, flush);
+
+    if (ret == Z_STREAM_ERROR) {
+      return false;
+    }
+
+    vec.iov_len -= zs.avail_out;
+    evbuffer_commit_space(out, &vec, 1);
+
+    // deflate is done with the input once it leaves room in the output
+    if (finish ? ret == Z_STREAM_END : zs.avail_out != 0) {
+      return true;
+    }
+  }
+}
+
+std::shared_ptr<const std::string> http::Compressor::compress(const char* data, size_t size) {
+  Compressor* c = acquire();
+
+  if (!c) {
+    return nullptr;
+  }
+
+  struct evbuffer* buf = evbuffer_new();
+  std::shared_ptr<std::string> body;
+
+  if (c->write(data, size, true, buf)) {
+    body = std::make_shared<std::string>(evbuffer_get_length(buf), '\0');
+    evbuffer_remove(buf, &(*body)[0], body->size());
+  }
+
+  evbuffer_free(buf);
+  release(c);
+
+  return body;
+}
@@ -0,0 +1,81 @@
+#ifndef COMPRESSOR_HPP
+#define COMPRESSOR_HPP
+
+#include <string>
+#include <memory>
+
+#include <zlib.h>
+
+#include <event2/buffer.h>
+
+namespace http {
+  /**
+   * A reusable gzip compressor. Setting up zlib state costs a few hundred kilobytes of
+   * allocations, so compressors are kept in a free list per thread and reset between
+   * responses instead of being created for each one.
+   */
+  class Compressor {
+    protected:
+      /**
+       * The compression level of new compressors
+       */
+      static int level;
+
+      z_stream zs;
+
+      /**
+       * Whether or not deflateInit2 succeeded
+       */
+      bool ready;
+
+      /**
+       * The next free compressor of the same thread
+       */
+      Compressor* next;
+
+      Compressor();
+
+    public:
+      ~Compressor();
+
+      Compressor(const Compressor&) = delete;
+      Compressor& operator=(const Compressor&) = delete;
+
+      /**
+       * Sets the compression level. Must be called before any compressor is used.
+       * @param level the zlib level, 1 to 9
+       */
+      static void configure(int level);
+
+      /**
+       * Takes a compressor from the free list of the calling thread, or makes a new one
+       * @return a reset compressor, or NULL if zlib could not be initialised
+       */
+      static Compressor* acquire();
+
+      /**
+       * Returns a compressor to the free list of the calling thread
+       * @param c the compressor
+       */
+      static void release(Compressor* c);
+
+      /**
+       * Compresses a block of data, appending the output to a buffer
+       * @param data the input
+       * @param size the number of input bytes
+       * @param finish whether or not this is the last block
+       * @param out the buffer receiving the compressed bytes
+       * @return false on a zlib error
+       */
+      bool write(const char* data, size_t size, bool finish, struct evbuffer* out);
+
+      /**
+       * Compresses a whole body in one go
+       * @param data the input
+       * @param size the number of input bytes
+       * @return the compressed body, or nullptr on error
+       */
+      static std::shared_ptr<const std::string> compress(const char* data, size_t size);
+  };
+};
+#endif
@@ -0,0 +1,418 @@
+#include <http/file_handler.hpp>
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <event2/util.h>
+
+#include <http/range.hpp>
+#include <http/compressor.hpp>
+#include <cache/sidecars.hpp>
+#include <metrics/trace.hpp>
+
+#include <stringutils.hpp>
+
+/**
+ * The codings files may be precompressed in, in order of preference. A file in
+ * a coding sits next to the original with the suffix appended.
+ */
+static const struct encoding {
+  const char* suffix;
+  const char* name;
+} encodings[] = {
+  { ".br", "br" },
+  { ".gz", "gzip" },
+  { NULL, NULL },
+};
+
+/**
+ * The bit of gzip in the encodings above, the coding used to compress on the fly
+ */
+static const unsigned GZIP = 1u << 1;
+
+/**
+ * Returns a bit for every entry of encodings the client accepts
+ */
+static unsigned accepted_encodings(const std::string& header) {
+  unsigned accepted = 0;
+  unsigned refused = 0;
+  bool any = false;
+  const char* pos = header.c_str();
+  const char* last = pos + header.size();
+
+  // runs once per request, so the items are taken apart in place
+  while (pos < last) {
+    const char* end = (const char*)memchr(pos, ',', last - pos);
+    if (!end) {
+      end = last;
+    }
+
+    const char* params = (const char*)memchr(pos, ';', end - pos);
+    string::slice name = string::utils::trimmed(string::slice(pos, (params ? params : end) - pos), " \t");
+
+    // a q-value of zero means "not acceptable"
+    bool refuse = false;
+
+    for (const char* q = params; q && q + 1 < end; q++) {
+      if (q[0] == 'q' && q[1] == '=') {
+        refuse = atof(q + 2) <= 0;
+        break;
+      }
+    }
+
+    pos = end + 1;
+
+    if (name == "*") {
+      any = !refuse;
+      continue;
+    }
+
+    for (unsigned i = 0; encodings[i].name; i++) {
+      if (name.size == strlen(encodings[i].name)
+          && evutil_ascii_strncasecmp(name.data, encodings[i].name, name.size) == 0) {
+        (refuse ? refused : accepted) |= 1u << i;
+      }
+    }
+  }
+
+  if (any) {
+    for (unsigned i = 0; encodings[i].name; i++) {
+      accepted |= 1u << i;
+    }
+  }
+
+  return accepted & ~refused;
+}
+
+http::FileHandler::FileHandler(const Site& s, const MimeTypes& mime, bool p, cache::ContentCache* cache,
+    cache::FdCache* fds)
+  : site(s), mime_types(mime), precompressed(p), suffixes(sidecarSuffixes()), compress(false), compression(),
+    content_cache(cache), fd_cache(fds) {
+}
+
+void http::FileHandler::enableCompression(const CompressionSettings& settings) {
+  compress = true;
+  compression = settings;
+}
+
+/**
+ * Adds the headers describing a file to a response and decides how much of it to send:
+ * nothing for a 304 or a 416, some ranges for a 206, or all of it.
+ * @return false if no body should be sent
+ */
+static bool describe(const http::Validators& validators, const std::string& content_type, off_t size,
+  const http::Request& req, http::Response& res, bool ranged = true) {
+  validators.apply(res);
+
+  if (validators.notModified(req)) {
+    res.setStatus(HTTP_NOTMODIFIED, "Not Modified");
+    return false;
+  }
+
+  if (!ranged) {
+    res.addHeader("Content-Type", content_type);
+    return true;
+  }
+
+  res.addHeader("Accept-Ranges", "bytes");
+
+  std::vector<http::ByteRange> ranges;
+  http::RangeResult result = http::RangeResult::IGNORED;
+
+  if (!req.range.empty() && validators.rangeApplies(req)) {
+    result = http::parse_ranges(req.range, size, ranges);
+  }
+
+  if (result == http::RangeResult::UNSATISFIABLE) {
+    res.setStatus(416, "Range Not Satisfiable");
+    res.addHeader("Content-Range", "bytes */" + std::to_string(size));
+    return false;
+  }
+
+  if (result == http::RangeResult::SATISFIABLE) {
+    res.setRanges(ranges, size, content_type);
+  } else {
+    res.addHeader("Content-Type", content_type);
+  }
+
+  return true;
+}
+
+http::FileHandler::Source::~Source() {
+  if (fd != -1) {
+    close(fd);
+  }
+}
+
+std::vector<std::string> http::FileHandler::sidecarSuffixes() {
+  std::vector<std::string> suffixes;
+
+  for (const struct encoding* e = &encodings[0]; e->suffix; ++e) {
+    suffixes.push_back(e->suffix);
+  }
+
+  return suffixes;
+}
+
+http::FileHandler::Lookup http::FileHandler::failure(int error) {
+  return error == ENOENT || error == ENOTDIR || error == EACCES || error == ENAMETOOLONG || error == EXDEV
+    || error == ELOOP ? Lookup::MISSING : Lookup::FAILED;
+}
+
+http::FileHandler::Lookup http::FileHandler::find(const std::string& path, Source& src, bool probe) {
+  const char* filename = path.c_str();
+
+  // a file held in memory needs no descriptor
+  auto hold = [&src](std::shared_ptr<const cache::CachedFile> file) {
+    src.cached = file;
+    src.size = file->body->size();
+    src.sidecars = file->sidecars;
+    src.validators = &file->validators;
+    src.content_type = &file->content_type;
+    return Lookup::FOUND;
+  };
+
+  if (content_cache) {
+    auto file = content_cache->lookup(path);
+
+    if (file) {
+      return hold(file);
+    }
+  }
+
+  // from here on the file is opened once, and a small one read into memory from that descriptor
+  if (fd_cache) {
+    auto file = fd_cache->get(path, mime_types.lookup(filename).c_str());
+
+    if (!file) {
+      return failure(errno);
+    }
+
+    if (content_cache && content_cache->fits(file->size)) {
+      auto cached = content_cache->load(path, file->fd, file->content_type.c_str());
+
+      if (cached) {
+        return hold(cached);
+      }
+    }
+
+    src.open = file;
+    src.size = file->size;
+    src.sidecars = file->sidecars;
+    src.validators = &file->validators;
+    src.content_type = &file->content_type;
+    return Lookup::FOUND;
+  }
+
+  // opening straight away answers both whether the file exists and whether it can be read
+  src.fd = site.open(path);
+
+  if (src.fd == -1) {
+    return failure(errno);
+  }
+
+  struct stat st;
+
+  if (fstat(src.fd, &st) != 0) {
+    return Lookup::FAILED;
+  }
+
+  if (!S_ISREG(st.st_mode)) {
+    return Lookup::MISSING;
+  }
+
+  if (content_cache && content_cache->fits(st.st_size)) {
+    auto cached = content_cache->load(path, src.fd, mime_types.lookup(filename).c_str());
+
+    if (cached) {
+      close(src.fd);
+      src.fd = -1;
+      return hold(cached);
+    }
+  }
+
+  src.size = st.st_size;
+  src.own_validators = Validators(st.st_ino, st.st_size, st.st_mtim, NULL);
+  src.own_type = mime_types.lookup(filename);
+  src.validators = &src.own_validators;
+  src.content_type = &src.own_type;
+
+  if (probe) {
+    src.sidecars = cache::probe_sidecars(path, suffixes);
+  }
+
+  return Lookup::FOUND;
+}
+
+void http::FileHandler::attach(Source& src, Response& res) {
+  if (src.cached) {
+    res.setBody(src.cached->body);
+  } else if (src.open) {
+    res.setFile(src.open->fd, src.size, src.open);
+  } else {
+    res.setFile(src.fd, src.size);
+    src.fd = -1;
+  }
+}
+
+bool http::FileHandler::compressible(const Source& src) {
+  if (src.size < compression.min_size) {
+    return false;
+  }
+
+  // compare the media type without its parameters
+  const std::string& type = *src.content_type;
+
+  for (const std::string& t : compression.types) {
+    if (type.compare(0, t.size(), t) == 0 && (type.size() == t.size() || type[t.size()] == ';')) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool http::FileHandler::serveCompressed(const std::string& path, Source& src, const Request& req, Response& res) {
+  // the compressed form is a different representation, and needs a tag of its own
+  Validators validators = *src.validators;
+
+  if (!validators.etag.empty()) {
+    validators.etag.insert(validators.etag.size() - 1, "-gzip");
+  }
+
+  if (!src.cached && src.size > compression.max_whole_size) {
+    // too large to hold in memory, compressed as the socket drains
+    res.addHeader("Content-Encoding", "gzip");
+
+    if (describe(validators, *src.content_type, src.size, req, res, false)) {
+      attach(src, res);
+      res.setCompressedStream();
+    }
+
+    return true;
+  }
+
+  if (validators.notModified(req)) {
+    validators.apply(res);
+    res.setStatus(HTTP_NOTMODIFIED, "Not Modified");
+    return true;
+  }
+
+  std::string key;
+  cache::VariantCache::BodyPtr body;
+
+  if (compression.variants) {
+    key = cache::VariantCache::key(path, src.validators->etag + src.validators->last_modified
+      + std::to_string(src.size), "gzip");
+    body = compression.variants->lookup(key);
+  }
+
+  if (!body) {
+    if (src.cached) {
+      body = Compressor::compress(src.cached->body->data(), src.cached->body->size());
+    } else {
+      std::string data(src.size, '\0');
+      int fd = src.open ? src.open->fd : src.fd;
+
+      if (pread(fd, &data[0], data.size(), 0) != (ssize_t)data.size()) {
+        return false;
+      }
+
+      body = Compressor::compress(data.data(), data.size());
+    }
+
+    if (!body) {
+      return false;
+    }
+
+    if (compression.variants) {
+      compression.variants->insert(key, body);
+    }
+  }
+
+  res.addHeader("Content-Encoding", "gzip");
+
+  if (describe(validators, *src.content_type, body->size(), req, res)) {
+    res.setBody(body);
+  }
+
+  return true;
+}
+
+bool http::FileHandler::serve(const std::string& path, const Request& req, Response& res) {
+  unsigned accepted = precompressed || compress ? accepted_encodings(req.accept_encoding) : 0;
+
+  Source src;
+  Lookup found = find(path, src, precompressed && accepted != 0);
+  metrics::Tracer::mark(req.trace, metrics::Phase::RESOLVED);
+
+  if (found == Lookup::MISSING) {
+    return false;
+  }
+
+  if (found == Lookup::FAILED) {
+    site.error(HTTP_INTERNAL, res);
+    return true;
+  }
+
+  // the sidecar bits came with the file, so negotiating costs no lookups unless one is sent
+  std::unique_ptr<Source> sidecar;
+  const struct encoding* coding = NULL;
+
+  if (precompressed || compress) {
+    // whether or not this file has sidecars now, the answer depends on the header
+    res.addHeader("Vary", "Accept-Encoding");
+  }
+
+  if (accepted & src.sidecars) {
+    for (unsigned i = 0; encodings[i].suffix && !coding; i++) {
+      if (!(src.sidecars & accepted & (1u << i))) {
+        continue;
+      }
+
+      sidecar.reset(new Source());
+
+      if (find(path + encodings[i].suffix, *sidecar, false) == Lookup::FOUND) {
+        coding = &encodings[i];
+      }
+    }
+  }
+
+  if (!coding && compress && (accepted & GZIP) && compressible(src) && serveCompressed(path, src, req, res)) {
+    return true;
+  }
+
+  Source& chosen = coding ? *sidecar : src;
+
+  if (coding) {
+    res.addHeader("Content-Encoding", coding->name);
+  }
+
+  // a sidecar has the content type of the file it was made from
+  if (describe(*chosen.validators, *src.content_type, chosen.size, req, res)) {
+    attach(chosen, res);
+  }
+
+  return true;
+}
+
+void http::FileHandler::handle(const Request& req, Response& res) {
+  if (req.path.empty()) {
+    site.error(HTTP_BADREQUEST, res);
+    return;
+  }
+
+  const std::string& root = site.getRoot();
+  std::string path;
+  path.reserve(root.size() + req.path.size());
+  path.append(root).append(req.path);
+
+  if (!serve(path, req, res)) {
+    site.error(HTTP_NOTFOUND, res);
+  }
+}
@@ -0,0 +1,204 @@
+#ifndef FILE_HANDLER_HPP
+#define FILE_HANDLER_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <http/request.hpp>
+#include <http/response.hpp>
+#include <http/validators.hpp>
+#include <http/mime_types.hpp>
+#include <http/site.hpp>
+#include <cache/content_cache.hpp>
+#include <cache/fd_cache.hpp>
+#include <cache/variant_cache.hpp>
+
+namespace http {
+  /**
+   * When and how files are compressed on the fly
+   */
+  struct CompressionSettings {
+    /**
+     * The media types worth compressing, without parameters
+     */
+    std::vector<std::string> types;
+
+    /**
+     * Files smaller than this are sent as they are
+     */
+    off_t min_size;
+
+    /**
+     * Files up to this size are compressed in one go and kept in the variant cache,
+     * larger ones are compressed while they are sent
+     */
+    off_t max_whole_size;
+
+    /**
+     * The cache of compressed files, or NULL
+     */
+    cache::VariantCache* variants;
+  };
+
+  /**
+   * The FileHandler maps request URIs onto files below the document root. It only does
+   * the blocking work (file system checks, opening files, building headers) and never
+   * touches the evhttp_request, so it can be called from any thread.
+   */
+  class FileHandler {
+    protected:
+      /**
+       * The document root and error pages
+       */
+      const Site& site;
+
+      /**
+       * The Content-Type of every known extension
+       */
+      const MimeTypes& mime_types;
+
+      /**
+       * Whether or not to look for precompressed sidecar files
+       */
+      bool precompressed;
+
+      /**
+       * The suffixes of the precompressed sidecars
+       */
+      std::vector<std::string> suffixes;
+
+      /**
+       * Whether or not to compress files without a precompressed sidecar
+       */
+      bool compress;
+
+      /**
+       * When and how files are compressed on the fly
+       */
+      CompressionSettings compression;
+
+      /**
+       * The in-memory cache of small files, or NULL if disabled
+       */
+      cache::ContentCache* content_cache;
+
+      /**
+       * The cache of open files, or NULL if disabled
+       */
+      cache::FdCache* fd_cache;
+
+      /**
+       * A file found in one of the caches or opened directly, with its metadata
+       */
+      struct Source {
+        std::shared_ptr<const cache::CachedFile> cached;
+        cache::FdCache::FilePtr open;
+
+        /**
+         * A descriptor opened without a cache, owned by the source until attached
+         */
+        int fd;
+
+        off_t size;
+        unsigned sidecars;
+        const Validators* validators;
+        const std::string* content_type;
+
+        /**
+         * The metadata of a file opened without a cache
+         */
+        Validators own_validators;
+        std::string own_type;
+
+        Source() : cached(), open(), fd(-1), size(0), sidecars(0), validators(NULL), content_type(NULL),
+          own_validators(), own_type() {
+        }
+
+        ~Source();
+
+        Source(const Source&) = delete;
+        Source& operator=(const Source&) = delete;
+      };
+
+      enum class Lookup {
+        FOUND,
+        MISSING,
+        FAILED
+      };
+
+      /**
+       * Tells a file that isn't there, or can't be read by anyone, from a failure to open it
+       * @param error the errno of the failed open
+       * @return MISSING or FAILED
+       */
+      static Lookup failure(int error);
+
+      /**
+       * Finds a file in the caches, or opens it
+       * @param path the resolved path
+       * @param src receives the file
+       * @param probe whether or not to look for sidecars of an uncached file
+       * @return whether the file was found, is missing or could not be opened
+       */
+      Lookup find(const std::string& path, Source& src, bool probe);
+
+      /**
+       * Hands the body of a source to a response
+       */
+      void attach(Source& src, Response& res);
+
+      /**
+       * Whether or not a file should be compressed on the fly
+       */
+      bool compressible(const Source& src);
+
+      /**
+       * Serves a file compressed on the fly, from the variant cache or a stream
+       * @return false if the file could not be compressed and should be sent as it is
+       */
+      bool serveCompressed(const std::string& path, Source& src, const Request& req, Response& res);
+
+      /**
+       * Serves a file from the cache or the file system, or a precompressed sidecar of it
+       * @param path the resolved path
+       * @param req the request, for its conditional headers
+       * @param res the response to fill in
+       * @return false if the path is not a file
+       */
+      bool serve(const std::string& path, const Request& req, Response& res);
+
+    public:
+      /**
+       * Creates a new file handler
+       * @param site the document root and error pages
+       * @param mime the content types of files
+       * @param precompressed whether or not to serve precompressed sidecar files
+       * @param cache the in-memory file cache, or NULL
+       * @param fds the open file cache, or NULL
+       */
+      FileHandler(const Site& site, const MimeTypes& mime, bool precompressed, cache::ContentCache* cache,
+        cache::FdCache* fds);
+
+      /**
+       * Enables compressing files on the fly for clients accepting gzip
+       * @param settings when and how to compress
+       */
+      void enableCompression(const CompressionSettings& settings);
+
+      /**
+       * Returns the suffixes of the precompressed sidecars, in order of preference. The
+       * caches must be given the same list, so that their sidecar bits line up.
+       * @return the sidecar suffixes
+       */
+      static std::vector<std::string> sidecarSuffixes();
+
+      /**
+       * Prepares the response for a request
+       * @param req the request
+       * @param res the response to fill in
+       */
+      void handle(const Request& req, Response& res);
+  };
+};
+#endif
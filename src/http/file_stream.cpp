@@ -0,0 +1,120 @@
+#include <http/file_stream.hpp>
+
+#include <event2/buffer.h>
+
+#include <http/response.hpp>
+
+off_t http::FileStream::threshold = 0;
+size_t http::FileStream::window = 256 * 1024;
+size_t http::FileStream::high_water = 1024 * 1024;
+void (*http::FileStream::reporter)(const StreamReport&) = NULL;
+
+void http::FileStream::configure(off_t t, size_t w, size_t h) {
+  threshold = t;
+  window = w > 0 ? w : 256 * 1024;
+  high_water = h >= window ? h : window;
+}
+
+void http::FileStream::setReporter(void (*fn)(const StreamReport&)) {
+  reporter = fn;
+}
+
+http::FileStream::FileStream(struct evhttp_request* r, int f, off_t b, off_t l, std::shared_ptr<const void> o)
+  : req(r), evcon(evhttp_request_get_connection(r)), fd(f), owner(o), base(b), offset(0), length(l),
+    started(clock::now()) {
+}
+
+void http::FileStream::start(struct evhttp_request* req, int status, const std::string& reason, int fd,
+    off_t first, off_t length, std::shared_ptr<const void> owner) {
+  // a detached request has no client left to stream to, and is ours to free
+  if (!evhttp_request_get_connection(req)) {
+    evhttp_send_reply_end(req);
+    return;
+  }
+
+  // with a Content-Length set, evhttp sends the body as is instead of chunking it
+  evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Length", std::to_string(length).c_str());
+  evhttp_send_reply_start(req, status, reason.c_str());
+
+  FileStream* stream = new FileStream(req, fd, first, length, owner);
+  evhttp_connection_set_closecb(stream->evcon, close_cb, stream);
+  stream->fill();
+}
+
+void http::FileStream::fill() {
+  if (offset >= length) {
+    finish(false);
+    return;
+  }
+
+  struct evbuffer* buf = evbuffer_new();
+  size_t queued = 0;
+
+  while (offset < length && queued < high_water) {
+    off_t n = length - offset < (off_t)window ? length - offset : (off_t)window;
+
+    // a segment per window keeps the read() fallback bounded when sendfile can't be used
+    struct evbuffer_file_segment* seg = evbuffer_file_segment_new(fd, base + offset, n, EVBUF_FS_DISABLE_MMAP);
+
+    if (!seg) {
+      break;
+    }
+
+    evbuffer_add_file_segment(buf, seg, 0, n);
+    evbuffer_file_segment_free(seg);
+
+    offset += n;
+    queued += n;
+  }
+
+  if (!queued) {
+    // the file can't be read, there is no way to recover after the headers went out
+    evbuffer_free(buf);
+    offset = length;
+    finish(true);
+    return;
+  }
+
+  evhttp_send_reply_chunk_with_cb(req, buf, written_cb, this);
+  evbuffer_free(buf);
+}
+
+void http::FileStream::finish(bool aborted) {
+  // before the end of the reply, which may complete the request right away
+  evhttp_connection_set_closecb(evcon, NULL, NULL);
+  Response::release(evcon, aborted);
+
+  if (aborted) {
+    evhttp_connection_free(evcon);
+  } else {
+    evhttp_send_reply_end(req);
+  }
+
+  report(aborted);
+  delete this;
+}
+
+void http::FileStream::report(bool aborted) {
+  if (reporter) {
+    std::chrono::duration<double> elapsed = clock::now() - started;
+    reporter(StreamReport { (uint64_t)offset, (uint64_t)length, elapsed.count(), aborted });
+  }
+}
+
+void http::FileStream::written_cb(struct evhttp_connection*, void* arg) {
+  static_cast<FileStream*>(arg)->fill();
+}
+
+void http::FileStream::close_cb(struct evhttp_connection* evcon, void* arg) {
+  FileStream* stream = static_cast<FileStream*>(arg);
+
+  // the client went away. If evhttp detached the request it is ours to free,
+  // otherwise it is freed along with the connection.
+  if (!evhttp_request_get_connection(stream->req)) {
+    evhttp_send_reply_end(stream->req);
+  }
+
+  Response::release(evcon, true);
+  stream->report(true);
+  delete stream;
+}
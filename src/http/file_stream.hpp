@@ -0,0 +1,141 @@
+#ifndef FILE_STREAM_HPP
+#define FILE_STREAM_HPP
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include <event2/http.h>
+
+namespace http {
+  /**
+   * Summary of a finished stream, handed to the stream reporter
+   */
+  struct StreamReport {
+    /**
+     * The bytes handed to the connection, and the size of the file
+     */
+    uint64_t bytes;
+    uint64_t length;
+    double seconds;
+    bool aborted;
+  };
+
+  /**
+   * A FileStream sends a large file in windows of file segments, which libevent writes
+   * with sendfile(2). A new batch of windows is only queued once the connection has
+   * written the previous one, so the output buffer of a connection never holds more
+   * than the high-water mark, no matter how slow the client is.
+   *
+   * Streams live on the event loop thread and delete themselves when they are done
+   * or when the connection closes.
+   */
+  class FileStream {
+    protected:
+      typedef std::chrono::steady_clock clock;
+
+      /**
+       * Files of at least this many bytes are streamed
+       */
+      static off_t threshold;
+
+      /**
+       * The size of a single file segment
+       */
+      static size_t window;
+
+      /**
+       * The maximum number of bytes queued on a connection at a time
+       */
+      static size_t high_water;
+
+      /**
+       * Called with a summary of every finished stream, or NULL
+       */
+      static void (*reporter)(const StreamReport&);
+
+      struct evhttp_request* req;
+      struct evhttp_connection* evcon;
+
+      /**
+       * The file being sent, kept open by the owner
+       */
+      int fd;
+      std::shared_ptr<const void> owner;
+
+      /**
+       * The first byte of the file to send
+       */
+      off_t base;
+
+      /**
+       * The number of bytes queued so far, and the number to send
+       */
+      off_t offset;
+      off_t length;
+
+      clock::time_point started;
+
+      FileStream(struct evhttp_request* req, int fd, off_t first, off_t length, std::shared_ptr<const void> owner);
+
+      /**
+       * Queues the next batch of windows, or ends the reply if everything has been written
+       */
+      void fill();
+
+      /**
+       * Reports the stream and deletes it
+       */
+      void finish(bool aborted);
+
+      /**
+       * Hands a summary of the stream to the reporter
+       */
+      void report(bool aborted);
+
+      static void written_cb(struct evhttp_connection*, void*);
+      static void close_cb(struct evhttp_connection*, void*);
+
+    public:
+      /**
+       * Sets the stream limits. Must be called before any stream is started.
+       * @param threshold files of at least this size are streamed
+       * @param window the size of a single file segment
+       * @param high_water the maximum number of bytes queued on a connection
+       */
+      static void configure(off_t threshold, size_t window, size_t high_water);
+
+      /**
+       * Sets a function to call with a summary of every finished stream
+       * @param fn the reporter, or NULL
+       */
+      static void setReporter(void (*fn)(const StreamReport&));
+
+      /**
+       * Whether or not a file of the given size should be streamed
+       * @param size the file size
+       * @return true if the file should be streamed
+       */
+      static bool streams(off_t size) {
+        return threshold > 0 && size >= threshold;
+      }
+
+      /**
+       * Starts streaming a file as the reply to a request. The status and headers must
+       * already be set, Content-Length is added here. Must be called on the event loop thread.
+       * @param req the request
+       * @param status the status code
+       * @param reason the reason phrase
+       * @param fd the file to send
+       * @param first the offset of the first byte to send
+       * @param length the number of bytes to send
+       * @param owner keeps the file open until the stream is done
+       */
+      static void start(struct evhttp_request* req, int status, const std::string& reason, int fd, off_t first,
+        off_t length, std::shared_ptr<const void> owner);
+  };
+};
+#endif
@@ -0,0 +1,210 @@
+#include <http/mime_types.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <exceptions.hpp>
+
+/**
+ * Types known even without a mime.types file
+ */
+static const struct builtin_type {
+  const char* extension;
+  const char* type;
+} builtin_types[] = {
+  { "txt", "text/plain" },
+  { "html", "text/html" },
+  { "htm", "text/html" },
+  { "css", "text/css" },
+  { "js", "application/javascript" },
+  { "mjs", "application/javascript" },
+  { "json", "application/json" },
+  { "map", "application/json" },
+  { "xml", "application/xml" },
+  { "svg", "image/svg+xml" },
+  { "gif", "image/gif" },
+  { "jpg", "image/jpeg" },
+  { "jpeg", "image/jpeg" },
+  { "png", "image/png" },
+  { "webp", "image/webp" },
+  { "avif", "image/avif" },
+  { "ico", "image/vnd.microsoft.icon" },
+  { "woff", "font/woff" },
+  { "woff2", "font/woff2" },
+  { "ttf", "font/ttf" },
+  { "otf", "font/otf" },
+  { "wasm", "application/wasm" },
+  { "pdf", "application/pdf" },
+  { "zip", "application/zip" },
+  { "gz", "application/gzip" },
+  { "mp3", "audio/mpeg" },
+  { "ogg", "audio/ogg" },
+  { "mp4", "video/mp4" },
+  { "webm", "video/webm" },
+  { NULL, NULL },
+};
+
+/**
+ * Whether a type describes text, and should carry a charset
+ */
+static bool is_textual(const std::string& type) {
+  if (type.compare(0, 5, "text/") == 0) {
+    return true;
+  }
+
+  if (type == "application/javascript" || type == "application/json" || type == "application/xml") {
+    return true;
+  }
+
+  size_t plus = type.rfind('+');
+  return plus != std::string::npos && (type.compare(plus, std::string::npos, "+xml") == 0 ||
+    type.compare(plus, std::string::npos, "+json") == 0);
+}
+
+http::MimeTypes::MimeTypes(const std::string& c, const std::string& fallback)
+  : table(64), used(0), charset(c), default_type() {
+  default_type = serialize(fallback);
+
+  for (const builtin_type* b = &builtin_types[0]; b->extension; ++b) {
+    add(b->extension, b->type);
+  }
+}
+
+uint32_t http::MimeTypes::hash(const char* ext, size_t len, char* lower) {
+  // FNV-1a
+  uint32_t h = 2166136261u;
+
+  for (size_t i = 0; i < len; i++) {
+    char c = ext[i];
+
+    if (c >= 'A' && c <= 'Z') {
+      c += 'a' - 'A';
+    }
+
+    lower[i] = c;
+    h = (h ^ (unsigned char)c) * 16777619u;
+  }
+
+  return h;
+}
+
+std::string http::MimeTypes::serialize(const std::string& type) {
+  if (charset.empty() || !is_textual(type)) {
+    return type;
+  }
+
+  return type + "; charset=" + charset;
+}
+
+void http::MimeTypes::grow() {
+  std::vector<Entry> old;
+  old.swap(table);
+  table.resize(old.size() * 2);
+
+  size_t mask = table.size() - 1;
+
+  for (Entry& e : old) {
+    if (e.extension.empty()) {
+      continue;
+    }
+
+    size_t i = e.hash & mask;
+    while (!table[i].extension.empty()) {
+      i = (i + 1) & mask;
+    }
+
+    table[i] = std::move(e);
+  }
+}
+
+void http::MimeTypes::add(const std::string& extension, const std::string& type) {
+  size_t len = extension.size();
+
+  if (len == 0 || len > MAX_EXTENSION) {
+    return;
+  }
+
+  // keep at least half of the buckets free, so probe sequences stay short
+  if ((used + 1) * 2 > table.size()) {
+    grow();
+  }
+
+  char lower[MAX_EXTENSION];
+  uint32_t h = hash(extension.data(), len, lower);
+  size_t mask = table.size() - 1;
+  size_t i = h & mask;
+
+  while (!table[i].extension.empty()) {
+    Entry& e = table[i];
+
+    if (e.hash == h && e.extension.size() == len && memcmp(e.extension.data(), lower, len) == 0) {
+      e.content_type = serialize(type);
+      return;
+    }
+
+    i = (i + 1) & mask;
+  }
+
+  table[i].extension.assign(lower, len);
+  table[i].content_type = serialize(type);
+  table[i].hash = h;
+  used++;
+}
+
+void http::MimeTypes::load(const std::string& path) {
+  std::ifstream in(path.c_str());
+
+  if (!in) {
+    throw FileNotFoundException("Unable to read mime types from " + path);
+  }
+
+  std::string line;
+
+  while (std::getline(in, line)) {
+    size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.erase(comment);
+    }
+
+    std::istringstream fields(line);
+    std::string type, extension;
+
+    if (!(fields >> type)) {
+      continue;
+    }
+
+    while (fields >> extension) {
+      add(extension, type);
+    }
+  }
+}
+
+const std::string& http::MimeTypes::lookup(const char* path) const {
+  const char* period = strrchr(path, '.');
+
+  if (!period || strchr(period, '/')) {
+    return default_type;
+  }
+
+  const char* extension = period + 1;
+  size_t len = strlen(extension);
+
+  if (len == 0 || len > MAX_EXTENSION) {
+    return default_type;
+  }
+
+  char lower[MAX_EXTENSION];
+  uint32_t h = hash(extension, len, lower);
+  size_t mask = table.size() - 1;
+
+  for (size_t i = h & mask; !table[i].extension.empty(); i = (i + 1) & mask) {
+    const Entry& e = table[i];
+
+    if (e.hash == h && e.extension.size() == len && memcmp(e.extension.data(), lower, len) == 0) {
+      return e.content_type;
+    }
+  }
+
+  return default_type;
+}
@@ -0,0 +1,108 @@
+#ifndef MIME_TYPES_HPP
+#define MIME_TYPES_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace http {
+  /**
+   * Maps file extensions onto Content-Type header values. The table is an open addressing
+   * hash table keyed on the lowercased extension, built once at startup from a mime.types
+   * file and a set of built-in types, and read-only afterwards, so any thread may look up
+   * types without locking. Every entry holds the complete header value, charset included,
+   * so a lookup builds no strings.
+   */
+  class MimeTypes {
+    public:
+      /**
+       * Extensions longer than this are never looked up
+       */
+      static const size_t MAX_EXTENSION = 15;
+
+    protected:
+      struct Entry {
+        std::string extension;
+        std::string content_type;
+        uint32_t hash;
+      };
+
+      /**
+       * The buckets, a power of two of them, empty ones have no extension
+       */
+      std::vector<Entry> table;
+
+      /**
+       * The number of used buckets
+       */
+      size_t used;
+
+      /**
+       * The charset appended to textual types
+       */
+      std::string charset;
+
+      /**
+       * The value for files without a known extension
+       */
+      std::string default_type;
+
+      /**
+       * Hashes and lowercases an extension
+       * @param ext the extension
+       * @param len its length
+       * @param lower receives the lowercased extension, MAX_EXTENSION bytes at most
+       * @return the hash
+       */
+      static uint32_t hash(const char* ext, size_t len, char* lower);
+
+      /**
+       * Builds the header value of a type, with the charset if it is textual
+       */
+      std::string serialize(const std::string& type);
+
+      /**
+       * Doubles the number of buckets
+       */
+      void grow();
+
+    public:
+      /**
+       * Creates a table holding the built-in types
+       * @param charset the charset of textual types, empty for none
+       * @param fallback the type of files without a known extension
+       */
+      MimeTypes(const std::string& charset, const std::string& fallback);
+
+      /**
+       * Adds the types of a mime.types file, one type per line followed by its extensions.
+       * Types from the file replace the built-in ones.
+       * @param path the path of the file
+       * @throws FileNotFoundException if the file cannot be read
+       */
+      void load(const std::string& path);
+
+      /**
+       * Maps an extension onto a type, replacing any earlier mapping
+       * @param extension the extension, without the period
+       * @param type the media type
+       */
+      void add(const std::string& extension, const std::string& type);
+
+      /**
+       * Looks up the Content-Type of a path by its extension
+       * @param path the path
+       * @return the header value
+       */
+      const std::string& lookup(const char* path) const;
+
+      /**
+       * Returns the number of known extensions
+       * @return the number of extensions
+       */
+      size_t size() const {
+        return used;
+      }
+  };
+};
+#endif
@@ -0,0 +1,108 @@
+#include <http/range.hpp>
+
+#include <cctype>
+#include <limits>
+
+/**
+ * Parses the digits at pos, advancing it
+ * @return false if there are no digits or the number overflows
+ */
+static bool parse_number(const std::string& s, size_t& pos, off_t& value) {
+  size_t start = pos;
+  value = 0;
+
+  while (pos < s.size() && isdigit((unsigned char)s[pos])) {
+    int digit = s[pos] - '0';
+
+    if (value > (std::numeric_limits<off_t>::max() - digit) / 10) {
+      return false;
+    }
+
+    value = value * 10 + digit;
+    pos++;
+  }
+
+  return pos > start;
+}
+
+static void skip_spaces(const std::string& s, size_t& pos) {
+  while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t')) {
+    pos++;
+  }
+}
+
+http::RangeResult http::parse_ranges(const std::string& header, off_t size, std::vector<ByteRange>& ranges) {
+  ranges.clear();
+
+  if (header.compare(0, 6, "bytes=") != 0) {
+    return RangeResult::IGNORED;
+  }
+
+  size_t pos = 6;
+  size_t specs = 0;
+
+  while (true) {
+    skip_spaces(header, pos);
+
+    // empty list elements are allowed
+    if (pos < header.size() && header[pos] == ',') {
+      pos++;
+      continue;
+    }
+
+    if (pos >= header.size()) {
+      break;
+    }
+
+    if (++specs > MAX_RANGES) {
+      return RangeResult::IGNORED;
+    }
+
+    off_t first, last;
+
+    if (header[pos] == '-') {
+      // the last n bytes
+      pos++;
+
+      if (!parse_number(header, pos, last)) {
+        return RangeResult::IGNORED;
+      }
+
+      if (last > 0 && size > 0) {
+        ByteRange r = { last < size ? size - last : 0, last < size ? last : size };
+        ranges.push_back(r);
+      }
+    } else {
+      if (!parse_number(header, pos, first) || pos >= header.size() || header[pos] != '-') {
+        return RangeResult::IGNORED;
+      }
+
+      pos++;
+
+      if (parse_number(header, pos, last)) {
+        if (last < first) {
+          return RangeResult::IGNORED;
+        }
+      } else {
+        last = size - 1;
+      }
+
+      if (first < size) {
+        ByteRange r = { first, (last < size ? last : size - 1) - first + 1 };
+        ranges.push_back(r);
+      }
+    }
+
+    skip_spaces(header, pos);
+
+    if (pos < header.size() && header[pos] != ',') {
+      return RangeResult::IGNORED;
+    }
+  }
+
+  if (specs == 0) {
+    return RangeResult::IGNORED;
+  }
+
+  return ranges.empty() ? RangeResult::UNSATISFIABLE : RangeResult::SATISFIABLE;
+}
@@ -0,0 +1,53 @@
+#ifndef RANGE_HPP
+#define RANGE_HPP
+
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace http {
+  /**
+   * The largest number of ranges honored in one request
+   */
+  static const size_t MAX_RANGES = 16;
+
+  /**
+   * A satisfiable byte range of a representation
+   */
+  struct ByteRange {
+    off_t first;
+    off_t length;
+  };
+
+  /**
+   * The outcome of parsing a Range header
+   */
+  enum class RangeResult {
+    /**
+     * No usable Range header, the whole representation is sent
+     */
+    IGNORED,
+
+    /**
+     * At least one range can be sent, with a 206
+     */
+    SATISFIABLE,
+
+    /**
+     * None of the ranges overlap the representation, a 416 is sent
+     */
+    UNSATISFIABLE
+  };
+
+  /**
+   * Parses the byte ranges of a Range header against a representation. Malformed headers,
+   * other range units and requests for more than MAX_RANGES ranges are ignored.
+   * @param header the Range header value
+   * @param size the size of the representation
+   * @param ranges receives the satisfiable ranges, in the order requested
+   * @return what to send
+   */
+  RangeResult parse_ranges(const std::string& header, off_t size, std::vector<ByteRange>& ranges);
+};
+#endif
@@ -0,0 +1,28 @@
+#include <http/request.hpp>
+
+#include <event2/keyvalq_struct.h>
+
+#include <http/uri.hpp>
+
+/**
+ * Returns the value of a request header, or the empty string
+ */
+static std::string header(evkeyvalq* headers, const char* name) {
+  const char* value = evhttp_find_header(headers, name);
+  return value ? value : "";
+}
+
+http::Request::Request(evhttp_request* req) : uri(evhttp_request_get_uri(req)), path(uri), if_none_match(),
+  if_modified_since(), range(), if_range(), accept_encoding(), trace(NULL) {
+  evkeyvalq* headers = evhttp_request_get_input_headers(req);
+
+  // the path is never longer than the URI, so it is normalized in place
+  ssize_t length = normalize_path(uri.data(), uri.size(), &path[0]);
+  path.resize(length > 0 ? length : 0);
+
+  if_none_match = header(headers, "If-None-Match");
+  if_modified_since = header(headers, "If-Modified-Since");
+  range = header(headers, "Range");
+  if_range = header(headers, "If-Range");
+  accept_encoding = header(headers, "Accept-Encoding");
+}
@@ -0,0 +1,61 @@
+#ifndef REQUEST_HPP
+#define REQUEST_HPP
+
+#include <string>
+
+#include <event2/http.h>
+
+namespace metrics {
+  struct Trace;
+};
+
+namespace http {
+  /**
+   * The parts of a request the handlers look at. They are copied off the evhttp_request
+   * on the event loop that owns it, so that workers never touch the evhttp_request.
+   */
+  struct Request {
+    /**
+     * The request URI, as sent
+     */
+    std::string uri;
+
+    /**
+     * The decoded and normalized path of the URI, empty if the URI is not a valid path
+     */
+    std::string path;
+
+    /**
+     * The conditional request headers, empty if absent
+     */
+    std::string if_none_match;
+    std::string if_modified_since;
+
+    /**
+     * The Range and If-Range headers, empty if absent
+     */
+    std::string range;
+    std::string if_range;
+
+    /**
+     * The Accept-Encoding header, empty if absent
+     */
+    std::string accept_encoding;
+
+    /**
+     * The trace of the request, NULL if it is not traced
+     */
+    metrics::Trace* trace;
+
+    Request() : uri(), path(), if_none_match(), if_modified_since(), range(), if_range(), accept_encoding(),
+      trace(NULL) {
+    }
+
+    /**
+     * Copies a request
+     * @param req the request
+     */
+    explicit Request(evhttp_request* req);
+  };
+};
+#endif
@@ -0,0 +1,263 @@
+#include <http/response.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#include <unistd.h>
+
+#include <event2/buffer.h>
+
+#include <http/file_stream.hpp>
+#include <http/compressed_stream.hpp>
+#include <metrics/registry.hpp>
+
+void (*http::Response::release_handler)(struct evhttp_connection*, bool) = NULL;
+
+http::Response::Response() : status(HTTP_OK), reason(""), headers(), body(), shared_body(), fd(-1), length(0),
+  file_owner(), ranges(), part_headers(), closing(), compressed_stream(false) {
+  // room for the usual headers of a file, so adding them does not grow the vector step by step
+  headers.reserve(8);
+}
+
+static void release_shared_body(const void*, size_t, void* arg) {
+  delete static_cast<std::shared_ptr<const std::string>*>(arg);
+}
+
+/**
+ * Closes a descriptor owned by a response once a stream is done with it
+ */
+struct OwnedFile {
+  int fd;
+
+  OwnedFile(int f) : fd(f) {
+  }
+
+  OwnedFile(const OwnedFile&) = delete;
+
+  ~OwnedFile() {
+    close(fd);
+  }
+};
+
+static void release_file_owner(struct evbuffer_file_segment const*, int, void* arg) {
+  delete static_cast<std::shared_ptr<const void>*>(arg);
+}
+
+http::Response::~Response() {
+  if (fd != -1 && !file_owner) {
+    close(fd);
+  }
+}
+
+void http::Response::setReleaseHandler(void (*fn)(struct evhttp_connection*, bool)) {
+  release_handler = fn;
+}
+
+void http::Response::release(struct evhttp_connection* evcon, bool aborted) {
+  if (release_handler) {
+    release_handler(evcon, aborted);
+  }
+}
+
+void http::Response::setStatus(int code, const std::string& phrase) {
+  status = code;
+  reason = phrase;
+}
+
+void http::Response::addHeader(const std::string& name, const std::string& value) {
+  headers.push_back(std::make_pair(name, value));
+}
+
+void http::Response::setBody(const std::string& data) {
+  body = data;
+}
+
+void http::Response::setBody(std::shared_ptr<const std::string> data) {
+  shared_body = data;
+}
+
+void http::Response::setFile(int file, off_t size) {
+  if (fd != -1 && !file_owner) {
+    close(fd);
+  }
+
+  fd = file;
+  length = size;
+  file_owner.reset();
+}
+
+void http::Response::setFile(int file, off_t size, std::shared_ptr<const void> owner) {
+  setFile(file, size);
+  file_owner = owner;
+}
+
+void http::Response::setRanges(const std::vector<ByteRange>& r, off_t size, const std::string& content_type) {
+  static std::atomic<uint64_t> boundaries(0);
+
+  ranges = r;
+  part_headers.clear();
+  setStatus(206, "Partial Content");
+
+  char buf[128];
+
+  if (ranges.size() == 1) {
+    snprintf(buf, sizeof(buf), "bytes %lld-%lld/%lld", (long long)ranges[0].first,
+      (long long)(ranges[0].first + ranges[0].length - 1), (long long)size);
+    addHeader("Content-Type", content_type);
+    addHeader("Content-Range", buf);
+    return;
+  }
+
+  uint64_t now = std::chrono::steady_clock::now().time_since_epoch().count();
+  snprintf(buf, sizeof(buf), "%016llx%08llx", (unsigned long long)now, (unsigned long long)boundaries++);
+  std::string boundary(buf);
+
+  addHeader("Content-Type", "multipart/byteranges; boundary=" + boundary);
+
+  for (const ByteRange& range : ranges) {
+    snprintf(buf, sizeof(buf), "bytes %lld-%lld/%lld", (long long)range.first,
+      (long long)(range.first + range.length - 1), (long long)size);
+    part_headers.push_back("\r\n--" + boundary + "\r\nContent-Type: " + content_type + "\r\nContent-Range: " + buf
+      + "\r\n\r\n");
+  }
+
+  closing = "\r\n--" + boundary + "--\r\n";
+}
+
+uint64_t http::Response::send(struct evhttp_request* req) {
+  // the client went away while the request waited for a worker. evhttp detached the
+  // request, which is now ours to free, and the connection was counted as aborted.
+  if (!evhttp_request_get_connection(req)) {
+    if (fd != -1 && !file_owner) {
+      close(fd);
+    }
+
+    fd = -1;
+    file_owner.reset();
+    evhttp_send_reply_end(req);
+    return 0;
+  }
+
+  struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req);
+
+  for (auto it = headers.begin(); it != headers.end(); ++it) {
+    evhttp_add_header(output_headers, it->first.c_str(), it->second.c_str());
+  }
+
+  struct evbuffer* buf = evhttp_request_get_output_buffer(req);
+
+  if (fd != -1 && compressed_stream) {
+    if (!file_owner) {
+      file_owner = std::make_shared<OwnedFile>(fd);
+    }
+
+    if (!CompressedStream::start(req, status, reason, fd, length, file_owner)) {
+      status = HTTP_INTERNAL;
+      reason = "Internal Server Error";
+    }
+
+    // the stream counts its compressed bytes as they go out
+    metrics::Registry::countResponse(status, 0);
+    fd = -1;
+    file_owner.reset();
+    return 0;
+  }
+
+  // a single range of a large file is streamed like a whole one
+  if (fd != -1 && ranges.size() <= 1) {
+    off_t first = ranges.empty() ? 0 : ranges[0].first;
+    off_t n = ranges.empty() ? length : ranges[0].length;
+
+    if (FileStream::streams(n)) {
+      if (!file_owner) {
+        file_owner = std::make_shared<OwnedFile>(fd);
+      }
+
+      metrics::Registry::countResponse(status, n);
+      FileStream::start(req, status, reason, fd, first, n, file_owner);
+      fd = -1;
+      file_owner.reset();
+      return n;
+    }
+  }
+
+  struct evbuffer_file_segment* seg = NULL;
+  off_t size = 0;
+
+  if (fd != -1) {
+    if (file_owner) {
+      // a segment that does not close the descriptor, but holds on to its owner until sent
+      seg = evbuffer_file_segment_new(fd, 0, length, 0);
+
+      if (seg) {
+        evbuffer_file_segment_add_cleanup_cb(seg, release_file_owner, new std::shared_ptr<const void>(file_owner));
+      }
+    } else {
+      // the segment closes the file once it has been sent
+      seg = evbuffer_file_segment_new(fd, 0, length, EVBUF_FS_CLOSE_ON_FREE);
+
+      if (!seg) {
+        close(fd);
+      }
+    }
+
+    fd = -1;
+    file_owner.reset();
+
+    // without a segment there is nothing to send the file from, and the headers promise it
+    if (!seg) {
+      status = HTTP_INTERNAL;
+      reason = "Internal Server Error";
+      evhttp_clear_headers(output_headers);
+      metrics::Registry::countResponse(status, 0);
+      evhttp_send_error(req, status, reason.c_str());
+      return 0;
+    }
+
+    size = length;
+  } else if (shared_body) {
+    size = shared_body->size();
+  } else {
+    size = body.size();
+  }
+
+  // adds a slice of whichever body is set
+  auto add = [&](off_t first, off_t n) {
+    if (n <= 0) {
+      return;
+    }
+
+    if (seg) {
+      evbuffer_add_file_segment(buf, seg, first, n);
+    } else if (shared_body) {
+      // keeps the body alive until the buffer is done with it
+      evbuffer_add_reference(buf, shared_body->data() + first, n, release_shared_body,
+        new std::shared_ptr<const std::string>(shared_body));
+    } else {
+      evbuffer_add(buf, body.data() + first, n);
+    }
+  };
+
+  if (ranges.empty()) {
+    add(0, size);
+  } else if (ranges.size() == 1) {
+    add(ranges[0].first, ranges[0].length);
+  } else {
+    for (size_t i = 0; i < ranges.size(); i++) {
+      evbuffer_add(buf, part_headers[i].data(), part_headers[i].size());
+      add(ranges[i].first, ranges[i].length);
+    }
+
+    evbuffer_add(buf, closing.data(), closing.size());
+  }
+
+  if (seg) {
+    evbuffer_file_segment_free(seg);
+  }
+
+  uint64_t bytes = evbuffer_get_length(buf);
+  metrics::Registry::countResponse(status, bytes);
+  evhttp_send_reply(req, status, reason.c_str(), buf);
+  return bytes;
+}
@@ -0,0 +1,193 @@
+#ifndef RESPONSE_HPP
+#define RESPONSE_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <cstdint>
+
+#include <sys/types.h>
+
+#include <event2/http.h>
+
+#include <http/range.hpp>
+
+namespace http {
+  /**
+   * A Response is everything needed to answer a request, prepared without touching
+   * the evhttp_request itself. It can be built on any thread, but must be sent
+   * on the event loop thread that owns the request.
+   */
+  class Response {
+    protected:
+      /**
+       * The HTTP status code
+       */
+      int status;
+
+      /**
+       * The reason phrase sent with the status code
+       */
+      std::string reason;
+
+      /**
+       * The headers to add to the reply
+       */
+      std::vector<std::pair<std::string, std::string>> headers;
+
+      /**
+       * The in-memory body, used when there is no file to send
+       */
+      std::string body;
+
+      /**
+       * A shared in-memory body, sent without copying it
+       */
+      std::shared_ptr<const std::string> shared_body;
+
+      /**
+       * The open file to send as the body, or -1. Owned by the response until sent.
+       */
+      int fd;
+
+      /**
+       * The number of bytes to send from the file
+       */
+      off_t length;
+
+      /**
+       * Keeps a shared descriptor open while it is being sent. If set, the response
+       * does not own the descriptor.
+       */
+      std::shared_ptr<const void> file_owner;
+
+      /**
+       * The parts of the body to send, or empty to send all of it
+       */
+      std::vector<ByteRange> ranges;
+
+      /**
+       * The headers preceding every part of a multipart/byteranges body, and its closing delimiter
+       */
+      std::vector<std::string> part_headers;
+      std::string closing;
+
+      /**
+       * Whether or not to gzip the file while sending it
+       */
+      bool compressed_stream;
+
+      /**
+       * Told when a stream is done with the close callback of a connection
+       */
+      static void (*release_handler)(struct evhttp_connection*, bool);
+
+    public:
+      /**
+       * Creates an empty 200 response
+       */
+      Response();
+
+      /**
+       * Closes the file if the response was never sent
+       */
+      ~Response();
+
+      Response(const Response&) = delete;
+      Response& operator=(const Response&) = delete;
+
+      /**
+       * Sets the function streams call when they are done with the close callback of a
+       * connection, which they take over while sending. Must be called before the event
+       * loops start.
+       * @param fn called on the event loop thread with the connection and whether the
+       *           response was abandoned, rather than sent in full
+       */
+      static void setReleaseHandler(void (*fn)(struct evhttp_connection*, bool));
+
+      /**
+       * Tells the release handler, if there is one, that a stream is done with a connection
+       * @param evcon the connection
+       * @param aborted whether the response was abandoned
+       */
+      static void release(struct evhttp_connection* evcon, bool aborted);
+
+      /**
+       * Sets the status code and reason phrase
+       * @param code the status code
+       * @param phrase the reason phrase
+       */
+      void setStatus(int code, const std::string& phrase);
+
+      /**
+       * Adds a header to the reply
+       * @param name the header name
+       * @param value the header value
+       */
+      void addHeader(const std::string& name, const std::string& value);
+
+      /**
+       * Sets an in-memory body
+       * @param data the body
+       */
+      void setBody(const std::string& data);
+
+      /**
+       * Sets a shared in-memory body. It is referenced, not copied, by the output buffer.
+       * @param data the body
+       */
+      void setBody(std::shared_ptr<const std::string> data);
+
+      /**
+       * Sets an open file as the body. The response takes ownership of the descriptor.
+       * @param file the file descriptor
+       * @param size the number of bytes to send
+       */
+      void setFile(int file, off_t size);
+
+      /**
+       * Sets a shared open file as the body. The descriptor stays open as long as the
+       * owner is referenced, and is never closed by the response.
+       * @param file the file descriptor
+       * @param size the number of bytes to send
+       * @param owner the object keeping the descriptor open
+       */
+      void setFile(int file, off_t size, std::shared_ptr<const void> owner);
+
+      /**
+       * Limits the body to a set of ranges and turns the response into a 206. A single range
+       * is sent with a Content-Range header, several as a multipart/byteranges body.
+       * Content-Type is added here, as it depends on the number of ranges.
+       * @param r the satisfiable ranges
+       * @param size the size of the whole body
+       * @param content_type the content type of the body
+       */
+      void setRanges(const std::vector<ByteRange>& r, off_t size, const std::string& content_type);
+
+      /**
+       * Gzips the file body while it is sent. The compressed length is unknown
+       * upfront, so the body is sent chunked and ranges are not supported.
+       */
+      void setCompressedStream() {
+        compressed_stream = true;
+      }
+
+      /**
+       * Returns the status code
+       * @return the status code
+       */
+      int getStatus() {
+        return status;
+      }
+
+      /**
+       * Sends the reply. Must be called on the event loop thread owning the request. If the
+       * reply can't be sent as prepared, an error is sent instead and becomes the status.
+       * @param req the request to answer
+       * @return the body bytes sent, 0 for a compressed stream, whose size is not known up front
+       */
+      uint64_t send(struct evhttp_request* req);
+  };
+};
+#endif
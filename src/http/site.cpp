@@ -0,0 +1,166 @@
+#include <http/site.hpp>
+
+#include <atomic>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <config.h>
+
+#ifdef HAVE_LINUX_OPENAT2_H
+#include <linux/openat2.h>
+#endif
+
+#include <exceptions.hpp>
+#include <stringutils.hpp>
+
+/**
+ * The statuses the server answers with an error page, and the bodies sent when the
+ * error template directory has no page for them
+ */
+static const struct builtin_page {
+  int status;
+  const char* reason;
+  const char* body;
+} builtin_pages[] = {
+  { HTTP_BADREQUEST, "Bad Request", "400: Bad request" },
+  { 403, "Forbidden", "403: Forbidden" },
+  { HTTP_NOTFOUND, "Not Found", "404: File not found" },
+  { HTTP_BADMETHOD, "Method Not Allowed", "405: Method not allowed" },
+  { HTTP_INTERNAL, "Internal Server Error", "500: Unable to open file" },
+  { HTTP_SERVUNAVAIL, "Service Unavailable", "503: Service unavailable" },
+  { 0, NULL, NULL },
+};
+
+/**
+ * Reads a whole file relative to a directory
+ * @return the contents, or nullptr if the file is missing or unreadable
+ */
+static std::shared_ptr<const std::string> read_file(int dir_fd, const char* name) {
+  int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+
+  if (fd == -1) {
+    return nullptr;
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return nullptr;
+  }
+
+  std::shared_ptr<std::string> body = std::make_shared<std::string>(st.st_size, '\0');
+  size_t done = 0;
+
+  while (done < body->size()) {
+    ssize_t n = read(fd, &(*body)[done], body->size() - done);
+
+    if (n <= 0) {
+      break;
+    }
+
+    done += n;
+  }
+
+  close(fd);
+  body->resize(done);
+
+  return body;
+}
+
+http::Site::Site(const std::string& r, const std::string& errors, const MimeTypes& mime_types)
+  : root(string::utils::chop(r, "/")), root_fd(-1), errors_fd(-1), error_pages() {
+  root_fd = ::open(root.empty() ? "/" : root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+  if (root_fd == -1) {
+    throw FileNotFoundException("Unable to open document root " + r);
+  }
+
+  std::string error_root = string::utils::chop(errors, "/");
+  errors_fd = ::open(error_root.empty() ? "/" : error_root.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+
+  for (const builtin_page* p = builtin_pages; p->status; p++) {
+    std::string name = std::to_string(p->status) + ".html";
+    ErrorPage page { p->status, p->reason, "text/plain", nullptr };
+
+    if (errors_fd != -1) {
+      page.body = read_file(errors_fd, name.c_str());
+    }
+
+    if (page.body) {
+      page.content_type = mime_types.lookup(name.c_str());
+    } else {
+      page.body = std::make_shared<std::string>(p->body);
+    }
+
+    error_pages.push_back(page);
+  }
+}
+
+http::Site::~Site() {
+  close(root_fd);
+
+  if (errors_fd != -1) {
+    close(errors_fd);
+  }
+}
+
+/**
+ * Set once openat2() turned out to be missing, from then on files are opened with openat()
+ */
+static std::atomic<bool> no_openat2(false);
+
+int http::Site::open(const std::string& path) const {
+  const char* relative = path.c_str() + root.size();
+
+  while (*relative == '/') {
+    relative++;
+  }
+
+  if (!*relative) {
+    relative = ".";
+  }
+
+#if defined(HAVE_LINUX_OPENAT2_H) && defined(SYS_openat2)
+  // the kernel refuses to leave the root, through ".." or symlinks alike, at no extra cost
+  if (!no_openat2.load(std::memory_order_relaxed)) {
+    struct open_how how = {};
+    how.flags = O_RDONLY | O_CLOEXEC;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+
+    int fd = syscall(SYS_openat2, root_fd, relative, &how, sizeof(how));
+
+    if (fd != -1 || errno != ENOSYS) {
+      return fd;
+    }
+
+    no_openat2.store(true, std::memory_order_relaxed);
+  }
+#endif
+
+  // normalized paths hold no "..", but symlinks are followed wherever they lead
+  return openat(root_fd, relative, O_RDONLY | O_CLOEXEC);
+}
+
+const http::ErrorPage& http::Site::errorPage(int status) const {
+  for (const ErrorPage& page : error_pages) {
+    if (page.status == status) {
+      return page;
+    }
+  }
+
+  // anything else is a server error
+  return errorPage(HTTP_INTERNAL);
+}
+
+void http::Site::error(int status, Response& res) const {
+  const ErrorPage& page = errorPage(status);
+
+  res.setStatus(status, status == page.status ? page.reason : "Error");
+  res.addHeader("Content-Type", page.content_type);
+  res.setBody(page.body);
+}
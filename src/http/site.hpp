@@ -0,0 +1,94 @@
+#ifndef SITE_HPP
+#define SITE_HPP
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <http/response.hpp>
+#include <http/mime_types.hpp>
+
+namespace http {
+  /**
+   * An error page, loaded from the error template directory or built in
+   */
+  struct ErrorPage {
+    int status;
+    const char* reason;
+    std::string content_type;
+    std::shared_ptr<const std::string> body;
+  };
+
+  /**
+   * The directories a server serves from, resolved once at startup. The document root and
+   * the error template directory are held open as O_PATH descriptors, so files are opened
+   * relative to them without walking the configured paths again, and the error pages are
+   * read into memory so that answering with an error touches neither the file system nor
+   * the configuration. Changes to the error templates take effect on restart.
+   */
+  class Site {
+    protected:
+      /**
+       * The document root, without trailing slashes
+       */
+      std::string root;
+
+      /**
+       * The document root and the error template directory, -1 if the latter is missing
+       */
+      int root_fd;
+      int errors_fd;
+
+      /**
+       * The error pages of all statuses the server answers with
+       */
+      std::vector<ErrorPage> error_pages;
+
+    public:
+      /**
+       * Opens the directories of a site and loads its error pages
+       * @param root the document root
+       * @param errors the error template directory, holding pages such as 404.html
+       * @param mime_types the types to send the error pages with
+       * @throws FileNotFoundException if the document root is not a directory
+       */
+      Site(const std::string& root, const std::string& errors, const MimeTypes& mime_types);
+
+      ~Site();
+
+      Site(const Site&) = delete;
+      Site& operator=(const Site&) = delete;
+
+      /**
+       * Returns the document root, without trailing slashes. Paths below it are the keys
+       * of the caches.
+       */
+      const std::string& getRoot() const {
+        return root;
+      }
+
+      /**
+       * Opens a file below the document root for reading. Where the kernel supports openat2(),
+       * resolution never leaves the root: escaping symlinks fail with EXDEV and magic links
+       * such as /proc/self/fd/N with ELOOP.
+       * @param path the normalized path of the file, starting with the document root
+       * @return the descriptor, or -1 with errno set
+       */
+      int open(const std::string& path) const;
+
+      /**
+       * Returns the error page of a status
+       * @param status the status code
+       * @return the page, a built-in one if the status has no template
+       */
+      const ErrorPage& errorPage(int status) const;
+
+      /**
+       * Turns a response into an error page
+       * @param status the status code
+       * @param res the response
+       */
+      void error(int status, Response& res) const;
+  };
+};
+#endif
@@ -0,0 +1,52 @@
+#include <http/status_handler.hpp>
+
+#include <algorithm>
+
+#include <event2/keyvalq_struct.h>
+
+#include <metrics/registry.hpp>
+
+http::StatusHandler::StatusHandler(const std::string& p, const std::vector<std::string>& a) : path(p),
+  allowed(a) {
+}
+
+bool http::StatusHandler::allows(evhttp_request* req) const {
+  if (allowed.empty()) {
+    return true;
+  }
+
+  struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+
+  if (!evcon) {
+    return false;
+  }
+
+  char* address = NULL;
+  ev_uint16_t port = 0;
+  evhttp_connection_get_peer(evcon, &address, &port);
+
+  return address && std::find(allowed.begin(), allowed.end(), address) != allowed.end();
+}
+
+bool http::StatusHandler::handle(evhttp_request* req, const Request& request, Response& res) const {
+  if (request.path != path || !allows(req)) {
+    return false;
+  }
+
+  const char* accept = evhttp_find_header(evhttp_request_get_input_headers(req), "Accept");
+  const char* query = evhttp_uri_get_query(evhttp_request_get_evhttp_uri(req));
+
+  bool json = (query && std::string(query).find("format=json") != std::string::npos)
+    || (accept && std::string(accept).find("application/json") != std::string::npos);
+
+  if (json) {
+    res.addHeader("Content-Type", "application/json");
+    res.setBody(metrics::Registry::json());
+  } else {
+    res.addHeader("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+    res.setBody(metrics::Registry::prometheus());
+  }
+
+  res.addHeader("Cache-Control", "no-store");
+  return true;
+}
@@ -0,0 +1,55 @@
+#ifndef STATUS_HANDLER_HPP
+#define STATUS_HANDLER_HPP
+
+#include <string>
+#include <vector>
+
+#include <event2/http.h>
+
+#include <http/request.hpp>
+#include <http/response.hpp>
+
+namespace http {
+  /**
+   * Answers the internal status endpoint with the server metrics, in the Prometheus text
+   * format or, when asked for with ?format=json or an Accept header naming application/json,
+   * as JSON. The endpoint is answered on the event loop, so it keeps working while the
+   * thread pool is saturated. Requests from addresses that are not allowed to see it are
+   * served from the document root as usual.
+   */
+  class StatusHandler {
+    protected:
+      /**
+       * The normalized path of the endpoint
+       */
+      std::string path;
+
+      /**
+       * The client addresses allowed to see the endpoint, empty to allow everyone
+       */
+      std::vector<std::string> allowed;
+
+      /**
+       * Returns true if the client of a request may see the endpoint
+       */
+      bool allows(evhttp_request* req) const;
+
+    public:
+      /**
+       * Creates a status handler
+       * @param path the path of the endpoint
+       * @param allowed the client addresses allowed to see it, empty to allow everyone
+       */
+      StatusHandler(const std::string& path, const std::vector<std::string>& allowed);
+
+      /**
+       * Answers a request for the endpoint. Must be called on the event loop that owns it.
+       * @param req the request
+       * @param request the parts of the request copied for the handlers
+       * @param res the response
+       * @return false if the request is not for the endpoint and res is untouched
+       */
+      bool handle(evhttp_request* req, const Request& request, Response& res) const;
+  };
+};
+#endif
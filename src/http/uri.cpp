@@ -0,0 +1,123 @@
+#include <http/uri.hpp>
+
+#include <event2/util.h>
+
+/**
+ * Returns the value of a hex digit, or -1
+ */
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+
+  return -1;
+}
+
+ssize_t http::normalize_path(const char* uri, size_t length, char* out) {
+  const char* p = uri;
+  const char* end = uri + length;
+
+  // absolute form, skip the scheme and the authority
+  bool absolute = false;
+
+  if (length >= 7 && evutil_ascii_strncasecmp(p, "http://", 7) == 0) {
+    p += 7;
+    absolute = true;
+  } else if (length >= 8 && evutil_ascii_strncasecmp(p, "https://", 8) == 0) {
+    p += 8;
+    absolute = true;
+  }
+
+  if (absolute) {
+    while (p < end && *p != '/' && *p != '?' && *p != '#') {
+      p++;
+    }
+
+    if (p == end || *p != '/') {
+      out[0] = '/';
+      out[1] = '\0';
+      return 1;
+    }
+  }
+
+  if (p == end || *p != '/') {
+    return -1;
+  }
+
+  // out[0, n) is the path so far, always ending in a slash between segments;
+  // the current segment starts at out[segment]
+  size_t n = 0;
+  size_t segment = 1;
+
+  out[n++] = '/';
+  p++;
+
+  while (true) {
+    bool last = p == end || *p == '?' || *p == '#';
+
+    if (last || *p == '/') {
+      size_t len = n - segment;
+
+      if (len == 1 && out[segment] == '.') {
+        n = segment;
+      } else if (len == 2 && out[segment] == '.' && out[segment + 1] == '.') {
+        n = segment;
+
+        // drop the slash and the segment before it, unless at the root
+        if (n > 1) {
+          n--;
+
+          while (out[n - 1] != '/') {
+            n--;
+          }
+        }
+      } else if (len > 0 && !last) {
+        out[n++] = '/';
+      }
+
+      if (last) {
+        break;
+      }
+
+      segment = n;
+      p++;
+      continue;
+    }
+
+    char c = *p++;
+
+    if (c == '%') {
+      int high = p < end ? hex_value(p[0]) : -1;
+      int low = p + 1 < end ? hex_value(p[1]) : -1;
+
+      if (high < 0 || low < 0) {
+        return -1;
+      }
+
+      c = (char)(high << 4 | low);
+      p += 2;
+
+      // an encoded slash would smuggle a separator past the segment checks
+      if (c == '/') {
+        return -1;
+      }
+    }
+
+    if (c == '\0') {
+      return -1;
+    }
+
+    out[n++] = c;
+  }
+
+  out[n] = '\0';
+  return n;
+}
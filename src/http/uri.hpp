@@ -0,0 +1,26 @@
+#ifndef URI_HPP
+#define URI_HPP
+
+#include <cstddef>
+
+#include <sys/types.h>
+
+namespace http {
+  /**
+   * Turns a request target into the path of a file in a single pass without allocating:
+   * the query and fragment are stripped, percent-escapes are decoded, empty and "."
+   * segments are dropped and ".." segments remove the segment before them, never
+   * climbing above the root. Dot segments are recognized after decoding, so "%2e%2e"
+   * is a ".." too. Targets in absolute form ("http://host/path") are reduced to their path.
+   *
+   * The path is never longer than the target, so out may be the target itself.
+   *
+   * @param uri the request target
+   * @param length the length of the target
+   * @param out receives the path and a terminating NUL, at least length + 1 bytes
+   * @return the length of the path, or -1 if the target is not a valid path: it does not
+   *   start with a slash, has a malformed escape, or holds a NUL or an encoded slash
+   */
+  ssize_t normalize_path(const char* uri, size_t length, char* out);
+};
+#endif
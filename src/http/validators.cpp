@@ -0,0 +1,126 @@
+#include <http/validators.hpp>
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <event2/util.h>
+
+http::ETagMode http::Validators::etag_mode = http::ETagMode::STRONG;
+
+/**
+ * Strips the weak indicator off a tag, for the weak comparison used with GET
+ */
+static std::string opaque_tag(const std::string& tag) {
+  return tag.compare(0, 2, "W/") == 0 ? tag.substr(2) : tag;
+}
+
+/**
+ * Checks whether a tag is in an If-None-Match list
+ */
+static bool list_matches(const std::string& list, const std::string& tag) {
+  std::string wanted = opaque_tag(tag);
+  size_t i = 0;
+
+  while (i < list.size()) {
+    while (i < list.size() && (list[i] == ' ' || list[i] == '\t' || list[i] == ',')) {
+      i++;
+    }
+
+    size_t start = i;
+
+    if (list.compare(i, 2, "W/") == 0) {
+      i += 2;
+    }
+
+    if (i < list.size() && list[i] == '"') {
+      // a quoted tag may contain commas
+      size_t end = list.find('"', i + 1);
+      i = end == std::string::npos ? list.size() : end + 1;
+    } else {
+      while (i < list.size() && list[i] != ',' && list[i] != ' ' && list[i] != '\t') {
+        i++;
+      }
+    }
+
+    std::string candidate = list.substr(start, i - start);
+
+    if (candidate == "*" || (!candidate.empty() && opaque_tag(candidate) == wanted)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+http::Validators::Validators(ino_t ino, off_t size, const struct timespec& mtime, const std::string* content)
+  : etag(), last_modified(), modified(mtime.tv_sec) {
+  char buf[96];
+
+  if (etag_mode == ETagMode::CONTENT && content) {
+    // FNV-1a over the contents
+    uint64_t h = 14695981039346656037ULL;
+
+    for (unsigned char c : *content) {
+      h = (h ^ c) * 1099511628211ULL;
+    }
+
+    snprintf(buf, sizeof(buf), "\"%llx\"", (unsigned long long)h);
+    etag = buf;
+  } else if (etag_mode != ETagMode::NONE) {
+    snprintf(buf, sizeof(buf), "%s\"%llx-%llx-%llx.%lx\"", etag_mode == ETagMode::WEAK ? "W/" : "",
+      (unsigned long long)ino, (unsigned long long)size, (unsigned long long)mtime.tv_sec, (long)mtime.tv_nsec);
+    etag = buf;
+  }
+
+  struct tm tm;
+  gmtime_r(&modified, &tm);
+  evutil_date_rfc1123(buf, sizeof(buf), &tm);
+  last_modified = buf;
+}
+
+void http::Validators::configure(ETagMode mode) {
+  etag_mode = mode;
+}
+
+bool http::Validators::notModified(const Request& req) const {
+  if (!req.if_none_match.empty()) {
+    return !etag.empty() && list_matches(req.if_none_match, etag);
+  }
+
+  if (!req.if_modified_since.empty()) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+
+    const char* end = strptime(req.if_modified_since.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+    if (!end) {
+      return false;
+    }
+
+    return modified <= timegm(&tm);
+  }
+
+  return false;
+}
+
+bool http::Validators::rangeApplies(const Request& req) const {
+  if (req.if_range.empty()) {
+    return true;
+  }
+
+  if (req.if_range[0] == '"' || req.if_range.compare(0, 2, "W/") == 0) {
+    // weak tags never match
+    return !etag.empty() && etag[0] == '"' && req.if_range == etag;
+  }
+
+  return req.if_range == last_modified;
+}
+
+void http::Validators::apply(Response& res) const {
+  if (!etag.empty()) {
+    res.addHeader("ETag", etag);
+  }
+
+  res.addHeader("Last-Modified", last_modified);
+}
@@ -0,0 +1,107 @@
+#ifndef VALIDATORS_HPP
+#define VALIDATORS_HPP
+
+#include <string>
+#include <ctime>
+
+#include <sys/types.h>
+
+#include <http/request.hpp>
+#include <http/response.hpp>
+
+namespace http {
+  /**
+   * How entity tags are generated
+   */
+  enum class ETagMode {
+    /**
+     * No ETag header is sent
+     */
+    NONE,
+
+    /**
+     * A strong tag made of the inode, size and modification time
+     */
+    STRONG,
+
+    /**
+     * The same tag, marked weak
+     */
+    WEAK,
+
+    /**
+     * A strong tag made of a hash of the contents, for files held in memory.
+     * Other files get a stat based tag.
+     */
+    CONTENT
+  };
+
+  /**
+   * The ETag and Last-Modified header values of a file, formatted once from its stat data
+   * so that they can be kept with the cached file and reused for every response.
+   */
+  class Validators {
+    protected:
+      /**
+       * How entity tags are generated
+       */
+      static ETagMode etag_mode;
+
+    public:
+      /**
+       * The ETag value, quotes included, or empty
+       */
+      std::string etag;
+
+      /**
+       * The Last-Modified value
+       */
+      std::string last_modified;
+
+      /**
+       * The modification time in seconds, to compare with If-Modified-Since
+       */
+      time_t modified;
+
+      Validators() : etag(), last_modified(), modified(0) {
+      }
+
+      /**
+       * Formats the validators of a file
+       * @param ino the inode of the file
+       * @param size the size of the file
+       * @param mtime the modification time of the file
+       * @param content the contents of the file if they are in memory, or NULL
+       */
+      Validators(ino_t ino, off_t size, const struct timespec& mtime, const std::string* content);
+
+      /**
+       * Sets how entity tags are generated
+       * @param mode the mode
+       */
+      static void configure(ETagMode mode);
+
+      /**
+       * Checks the conditional headers of a request. If-None-Match takes precedence,
+       * If-Modified-Since is only looked at without it.
+       * @param req the request
+       * @return true if the client's copy is current and a 304 should be sent
+       */
+      bool notModified(const Request& req) const;
+
+      /**
+       * Checks the If-Range header of a request. An entity tag must match strongly,
+       * a date must match Last-Modified exactly.
+       * @param req the request
+       * @return true if the Range header should be honored
+       */
+      bool rangeApplies(const Request& req) const;
+
+      /**
+       * Adds the ETag and Last-Modified headers to a response
+       * @param res the response
+       */
+      void apply(Response& res) const;
+  };
+};
+#endif
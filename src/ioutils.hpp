@@ -8,6 +8,7 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 namespace io {
   /**
@@ -16,31 +17,32 @@ namespace io {
   class utils {
     public:
       /**
-       * Runs the file size of a file
+       * Returns the size of a file
+       * @param filename the path to the file
+       * @return the size in bytes, -1 if the file does not exist
        */
-      static std::ifstream::pos_type filesize(std::string filename) {
-        std::ifstream in(filename.c_str(), std::ifstream::binary | std::ifstream::ate);
-        return in.tellg(); 
+      static off_t filesize(const char* filename) {
+        struct stat st;
+        return stat(filename, &st) == 0 ? st.st_size : -1;
+      }
+
+      static off_t filesize(const std::string& filename) {
+        return filesize(filename.c_str());
       }
 
       /**
-       * Checks whether or not the given pathname is a file on
+       * Checks whether or not the given pathname is a readable file on
        * the file system.
-       * @param filename the path to the gile
+       * @param filename the path to the file
        * @return true if the path is a file, false otherwise
        */
-      static bool isFile (std::string filename) {
-        if (isDirectory (filename)) {
-          return false;
-        }
-
-        std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
-        if (in) {
-          in.close();
-          return true;
-        }
-
-        return false;
+      static bool isFile(const char* filename) {
+        struct stat st;
+        return stat(filename, &st) == 0 && S_ISREG(st.st_mode) && access(filename, R_OK) == 0;
+      }
+
+      static bool isFile(const std::string& filename) {
+        return isFile(filename.c_str());
       }
 
       /**
@@ -49,13 +51,13 @@ namespace io {
        * @param path the path to the directory
        * @return true if the path is a directory, false otherwise
        */
-      static bool isDirectory (std::string path) {
+      static bool isDirectory(const char* path) {
         struct stat st;
-        if (stat(path.c_str(), &st) == 0 && S_ISDIR (st.st_mode)) {
-          return true;
-        }
+        return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+      }
 
-        return false;
+      static bool isDirectory(const std::string& path) {
+        return isDirectory(path.c_str());
       }
   };
 };
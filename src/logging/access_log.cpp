@@ -0,0 +1,396 @@
+#include <logging/access_log.hpp>
+
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <event2/http_struct.h>
+#include <event2/keyvalq_struct.h>
+
+#include <exceptions.hpp>
+
+/**
+ * Bytes of formatted lines collected before they are written
+ */
+static const size_t BATCH = 256 * 1024;
+
+logging::Ring::Ring(uint64_t capacity) : head(0), tail(0), cached_tail(0), dropped(0), records(NULL),
+  mask(capacity - 1) {
+  records = new Record[capacity];
+}
+
+logging::Ring::~Ring() {
+  delete[] records;
+}
+
+logging::Record* logging::Ring::claim() {
+  uint64_t h = head.load(std::memory_order_relaxed);
+
+  if (h - cached_tail > mask) {
+    cached_tail = tail.load(std::memory_order_acquire);
+
+    if (h - cached_tail > mask) {
+      return NULL;
+    }
+  }
+
+  return &records[h & mask];
+}
+
+const logging::Record* logging::Ring::peek() {
+  uint64_t t = tail.load(std::memory_order_relaxed);
+
+  if (t == head.load(std::memory_order_acquire)) {
+    return NULL;
+  }
+
+  return &records[t & mask];
+}
+
+logging::AccessLog::AccessLog(const std::string& p, Format f, Overflow o, uint64_t size,
+  std::chrono::milliseconds i) : path(p), format(f), overflow(o), ring_size(1), interval(i), fd(-1), mutex(),
+    wakeup(), rings(), stopping(false), writer(), reopening(false), buffer(), formatted_second(-1),
+    formatted_time() {
+  while (ring_size < size) {
+    ring_size <<= 1;
+  }
+
+  fd = open();
+
+  if (fd == -1) {
+    throw IOException(errno, "Failed to open access log " + path + ": " + strerror(errno));
+  }
+
+  buffer.reserve(BATCH + 4096);
+}
+
+logging::AccessLog::~AccessLog() {
+  if (writer.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+
+    wakeup.notify_one();
+    writer.join();
+  }
+
+  drain();
+  flush();
+
+  if (fd != STDOUT_FILENO) {
+    close(fd);
+  }
+
+  for (Ring* ring : rings) {
+    ring->~Ring();
+    free(ring);
+  }
+}
+
+int logging::AccessLog::open() const {
+  if (path == "-") {
+    return STDOUT_FILENO;
+  }
+
+  return ::open(path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+}
+
+void logging::AccessLog::start() {
+  writer = std::thread(&AccessLog::run, this);
+}
+
+logging::Ring& logging::AccessLog::local() {
+  static thread_local Ring* ring = NULL;
+  static thread_local AccessLog* owner = NULL;
+
+  if (owner != this) {
+    // the ring is aligned to cache lines, which operator new does not promise before C++17
+    void* memory = NULL;
+
+    if (posix_memalign(&memory, alignof(Ring), sizeof(Ring)) != 0) {
+      throw std::bad_alloc();
+    }
+
+    ring = new(memory) Ring(ring_size);
+    owner = this;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    rings.push_back(ring);
+  }
+
+  return *ring;
+}
+
+/**
+ * Copies a string into a fixed-size field, truncating it
+ */
+template<size_t N> static void copy(char (&field)[N], const char* value) {
+  if (!value) {
+    field[0] = '\0';
+    return;
+  }
+
+  size_t n = strnlen(value, N - 1);
+  memcpy(field, value, n);
+  field[n] = '\0';
+}
+
+static const char* method_name(enum evhttp_cmd_type method) {
+  switch (method) {
+    case EVHTTP_REQ_GET:
+      return "GET";
+    case EVHTTP_REQ_HEAD:
+      return "HEAD";
+    case EVHTTP_REQ_POST:
+      return "POST";
+    case EVHTTP_REQ_PUT:
+      return "PUT";
+    case EVHTTP_REQ_DELETE:
+      return "DELETE";
+    case EVHTTP_REQ_OPTIONS:
+      return "OPTIONS";
+    default:
+      return "-";
+  }
+}
+
+logging::Record* logging::AccessLog::begin(evhttp_request* req, uint64_t received) {
+  Ring& ring = local();
+  Record* record = ring.claim();
+
+  while (!record && overflow == Overflow::BLOCK) {
+    std::this_thread::yield();
+    record = ring.claim();
+  }
+
+  if (!record) {
+    ring.drop();
+    return NULL;
+  }
+
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  uint64_t steady = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+
+  record->time = std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+  record->duration = steady > received ? steady - received : 0;
+  record->major = req->major;
+  record->minor = req->minor;
+
+  copy(record->method, method_name(evhttp_request_get_command(req)));
+  copy(record->uri, evhttp_request_get_uri(req));
+
+  evkeyvalq* headers = evhttp_request_get_input_headers(req);
+  copy(record->referer, evhttp_find_header(headers, "Referer"));
+  copy(record->user_agent, evhttp_find_header(headers, "User-Agent"));
+
+  struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+  char* address = NULL;
+  ev_uint16_t port = 0;
+
+  if (evcon) {
+    evhttp_connection_get_peer(evcon, &address, &port);
+  }
+
+  copy(record->client, address);
+  return record;
+}
+
+void logging::AccessLog::commit(Record* record, int status, uint64_t bytes) {
+  if (!record) {
+    return;
+  }
+
+  record->status = status;
+  record->bytes = bytes;
+  local().commit();
+}
+
+void logging::AccessLog::reopen() {
+  reopening.store(true, std::memory_order_relaxed);
+  wakeup.notify_one();
+}
+
+uint64_t logging::AccessLog::dropped() {
+  std::lock_guard<std::mutex> lock(mutex);
+  uint64_t n = 0;
+
+  for (Ring* ring : rings) {
+    n += ring->getDropped();
+  }
+
+  return n;
+}
+
+/**
+ * Appends a string, escaping quotes, backslashes and control characters. The combined
+ * format escapes them as \xHH like Apache, JSON as \u00HH.
+ */
+static void escape(std::string& out, const char* value, bool json) {
+  static const char hex[] = "0123456789abcdef";
+
+  for (const unsigned char* p = (const unsigned char*)value; *p; p++) {
+    if (*p == '"' || *p == '\\') {
+      out += '\\';
+      out += *p;
+    } else if (*p < 0x20 || *p == 0x7f) {
+      out += json ? "\\u00" : "\\x";
+      out += hex[*p >> 4];
+      out += hex[*p & 15];
+    } else {
+      out += *p;
+    }
+  }
+}
+
+void logging::AccessLog::append(const Record& record) {
+  int64_t second = record.time / 1000000;
+
+  if (second != formatted_second) {
+    time_t t = second;
+    struct tm tm;
+    localtime_r(&t, &tm);
+
+    char buf[64];
+    strftime(buf, sizeof(buf), format == Format::JSON ? "%Y-%m-%dT%H:%M:%S%z" : "%d/%b/%Y:%H:%M:%S %z", &tm);
+    formatted_time = buf;
+    formatted_second = second;
+  }
+
+  char numbers[128];
+
+  if (format == Format::COMBINED) {
+    buffer += record.client[0] ? record.client : "-";
+    buffer += " - - [";
+    buffer += formatted_time;
+    buffer += "] \"";
+    buffer += record.method;
+    buffer += ' ';
+    escape(buffer, record.uri, false);
+
+    snprintf(numbers, sizeof(numbers), " HTTP/%d.%d\" %d ", record.major, record.minor, record.status);
+    buffer += numbers;
+
+    if (record.bytes > 0) {
+      buffer += std::to_string(record.bytes);
+    } else {
+      buffer += '-';
+    }
+
+    buffer += " \"";
+    escape(buffer, record.referer[0] ? record.referer : "-", false);
+    buffer += "\" \"";
+    escape(buffer, record.user_agent[0] ? record.user_agent : "-", false);
+    buffer += "\"\n";
+    return;
+  }
+
+  // the milliseconds go between the seconds and the zone
+  buffer += "{\"time\":\"";
+  buffer.append(formatted_time, 0, 19);
+  snprintf(numbers, sizeof(numbers), ".%03d", (int)(record.time / 1000 % 1000));
+  buffer += numbers;
+  buffer.append(formatted_time, 19, std::string::npos);
+  buffer += "\",\"client\":\"";
+  escape(buffer, record.client, true);
+  buffer += "\",\"method\":\"";
+  buffer += record.method;
+  buffer += "\",\"uri\":\"";
+  escape(buffer, record.uri, true);
+
+  snprintf(numbers, sizeof(numbers), "\",\"protocol\":\"HTTP/%d.%d\",\"status\":%d,\"bytes\":%llu,\"duration_us\":%u",
+    record.major, record.minor, record.status, (unsigned long long)record.bytes, record.duration);
+  buffer += numbers;
+
+  buffer += ",\"referer\":\"";
+  escape(buffer, record.referer, true);
+  buffer += "\",\"user_agent\":\"";
+  escape(buffer, record.user_agent, true);
+  buffer += "\"}\n";
+}
+
+void logging::AccessLog::flush() {
+  size_t written = 0;
+
+  while (written < buffer.size()) {
+    ssize_t n = write(fd, buffer.data() + written, buffer.size() - written);
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    // there is no one to tell but the error stream, the lines are lost
+    if (n <= 0) {
+      perror("access log");
+      break;
+    }
+
+    written += n;
+  }
+
+  buffer.clear();
+}
+
+size_t logging::AccessLog::drain() {
+  std::vector<Ring*> current;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    current = rings;
+  }
+
+  size_t count = 0;
+
+  for (Ring* ring : current) {
+    while (const Record* record = ring->peek()) {
+      append(*record);
+      ring->pop();
+      count++;
+
+      if (buffer.size() >= BATCH) {
+        flush();
+      }
+    }
+  }
+
+  return count;
+}
+
+void logging::AccessLog::run() {
+  while (true) {
+    if (reopening.exchange(false, std::memory_order_relaxed)) {
+      // lines formatted so far belong to the old file
+      flush();
+      int file = open();
+
+      if (file == -1) {
+        perror(("access log " + path).c_str());
+      } else if (file != fd) {
+        close(fd);
+        fd = file;
+      }
+    }
+
+    // keep going while there is work, only wait once every ring is empty
+    if (drain() > 0) {
+      continue;
+    }
+
+    flush();
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (stopping) {
+      return;
+    }
+
+    wakeup.wait_for(lock, interval);
+  }
+}
@@ -0,0 +1,286 @@
+#ifndef ACCESS_LOG_HPP
+#define ACCESS_LOG_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+#include <event2/http.h>
+
+namespace logging {
+  /**
+   * The line formats of the access log
+   */
+  enum class Format {
+    /**
+     * The NCSA combined log format
+     */
+    COMBINED,
+
+    /**
+     * One JSON object per line
+     */
+    JSON
+  };
+
+  /**
+   * What a thread does when its ring is full
+   */
+  enum class Overflow {
+    /**
+     * Drop the record and count it
+     */
+    DROP,
+
+    /**
+     * Wait for the writer to make room
+     */
+    BLOCK
+  };
+
+  /**
+   * A fixed-size access log record. Strings are truncated to fit and NUL-terminated.
+   */
+  struct Record {
+    /**
+     * When the response was sent, in microseconds since the epoch
+     */
+    int64_t time;
+
+    /**
+     * Body bytes sent, 0 if unknown
+     */
+    uint64_t bytes;
+
+    /**
+     * Microseconds from receiving the request to sending the response
+     */
+    uint32_t duration;
+
+    uint16_t status;
+    uint8_t major;
+    uint8_t minor;
+
+    char method[8];
+    char client[48];
+    char uri[256];
+    char referer[128];
+    char user_agent[128];
+  };
+
+  /**
+   * A single-producer, single-consumer ring of records. The producer claims a slot,
+   * fills it in place and commits it; the writer thread consumes committed records.
+   */
+  class Ring {
+    protected:
+      /**
+       * The next slot to fill, written by the producer only
+       */
+      alignas(64) std::atomic<uint64_t> head;
+
+      /**
+       * The next slot to consume, written by the writer only
+       */
+      alignas(64) std::atomic<uint64_t> tail;
+
+      /**
+       * The producer's last look at the tail, so that it rarely touches the writer's line
+       */
+      alignas(64) uint64_t cached_tail;
+
+      /**
+       * Records dropped because the ring was full
+       */
+      std::atomic<uint64_t> dropped;
+
+      Record* records;
+      uint64_t mask;
+
+    public:
+      /**
+       * Creates a ring
+       * @param capacity the number of records, a power of two
+       */
+      Ring(uint64_t capacity);
+
+      ~Ring();
+
+      Ring(const Ring&) = delete;
+      Ring& operator=(const Ring&) = delete;
+
+      /**
+       * Claims the next slot. Producer only.
+       * @return the slot, or NULL if the ring is full
+       */
+      Record* claim();
+
+      /**
+       * Publishes the claimed slot. Producer only.
+       */
+      void commit() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      }
+
+      /**
+       * Counts a dropped record. Producer only.
+       */
+      void drop() {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      }
+
+      uint64_t getDropped() const {
+        return dropped.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Returns the oldest committed record, or NULL if there is none. Writer only.
+       */
+      const Record* peek();
+
+      /**
+       * Frees the oldest committed record. Writer only.
+       */
+      void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+      }
+  };
+
+  /**
+   * The access log. Threads answering requests copy what is logged into fixed-size records
+   * in rings of their own, without locks or system calls; a writer thread formats the
+   * records and appends them to the log file in large batches. The file is reopened on
+   * request, for log rotation.
+   */
+  class AccessLog {
+    protected:
+      std::string path;
+      Format format;
+      Overflow overflow;
+      uint64_t ring_size;
+
+      /**
+       * How long the writer sleeps when all rings are empty
+       */
+      std::chrono::milliseconds interval;
+
+      /**
+       * The log file, only used by the writer once started
+       */
+      int fd;
+
+      /**
+       * Guards the list of rings and the writer state
+       */
+      std::mutex mutex;
+      std::condition_variable wakeup;
+      std::vector<Ring*> rings;
+      bool stopping;
+      std::thread writer;
+
+      std::atomic<bool> reopening;
+
+      /**
+       * The lines formatted since the last write
+       */
+      std::string buffer;
+
+      /**
+       * The formatted second of the last record and its time, so that time is formatted
+       * once per second rather than per record
+       */
+      int64_t formatted_second;
+      std::string formatted_time;
+
+      /**
+       * Returns the ring of the calling thread, creating it on first use
+       */
+      Ring& local();
+
+      /**
+       * Opens the log file
+       * @return the descriptor, or -1 with errno set
+       */
+      int open() const;
+
+      /**
+       * Formats a record onto the buffer
+       */
+      void append(const Record& record);
+
+      /**
+       * Writes out the buffer
+       */
+      void flush();
+
+      /**
+       * Formats and writes out all committed records
+       * @return the number of records written
+       */
+      size_t drain();
+
+      /**
+       * The writer thread
+       */
+      void run();
+
+    public:
+      /**
+       * Opens an access log
+       * @param path the log file, "-" for the standard output
+       * @param format the line format
+       * @param overflow what threads do when their ring is full
+       * @param ring_size the number of records a thread can have outstanding, rounded up to a power of two
+       * @param interval how long the writer waits for records when there are none
+       * @throws IOException if the file can't be opened
+       */
+      AccessLog(const std::string& path, Format format, Overflow overflow, uint64_t ring_size,
+        std::chrono::milliseconds interval);
+
+      /**
+       * Writes out all records and closes the log. No thread may log any more.
+       */
+      ~AccessLog();
+
+      AccessLog(const AccessLog&) = delete;
+      AccessLog& operator=(const AccessLog&) = delete;
+
+      /**
+       * Starts the writer thread
+       */
+      void start();
+
+      /**
+       * Starts a record of a request, which must be done before the response is sent, as the
+       * request may be freed after that. The record is only logged once it is committed.
+       * @param req the request
+       * @param received the steady time the request arrived, in microseconds
+       * @return the record, or NULL if it was dropped
+       */
+      Record* begin(evhttp_request* req, uint64_t received);
+
+      /**
+       * Commits a record started on the calling thread
+       * @param record the record
+       * @param status the status sent
+       * @param bytes the body bytes sent
+       */
+      void commit(Record* record, int status, uint64_t bytes);
+
+      /**
+       * Asks the writer to reopen the log file, after it has been moved away for rotation
+       */
+      void reopen();
+
+      /**
+       * Returns the number of records dropped because a ring was full
+       */
+      uint64_t dropped();
+  };
+};
+#endif
@@ -1,8 +1,14 @@
 #include <memory>
 #include <cstdint>
 #include <cstring>
+#include <csignal>
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
 
 #include <event2/event.h>
 #include <event2/buffer.h>
@@ -11,11 +17,8 @@
 #include <event2/thread.h>
 #include <event2/keyvalq_struct.h>
 
-#include <stdio.h>
-#include <fcntl.h>
-
-#include <ioutils.hpp>
-#include <stringutils.hpp>
+#include <unistd.h>
+#include <sys/wait.h>
 
 #include <exceptions.hpp>
 #include <config/config_source.hpp>
@@ -25,81 +28,197 @@
 #include <config/config_default.hpp>
 #include <config/configurator.hpp>
 
+#include <concurrency/epoch.hpp>
+#include <concurrency/executor.hpp>
 #include <concurrency/thread_pool.hpp>
+#include <concurrency/work_stealing_pool.hpp>
+#include <concurrency/sharded_pool.hpp>
+#include <net/reactor.hpp>
+#include <net/upgrade.hpp>
+#include <http/request.hpp>
+#include <http/response.hpp>
+#include <http/validators.hpp>
+#include <http/site.hpp>
+#include <http/file_handler.hpp>
+#include <http/mime_types.hpp>
+#include <http/file_stream.hpp>
+#include <http/compressor.hpp>
+#include <http/compressed_stream.hpp>
+#include <http/status_handler.hpp>
+#include <cache/content_cache.hpp>
+#include <cache/fd_cache.hpp>
+#include <cache/variant_cache.hpp>
+#include <metrics/registry.hpp>
+#include <metrics/trace.hpp>
+#include <logging/access_log.hpp>
 
-static config::Configurator cfg;
-static concurrency::ThreadPool thread_pool(5, false);
-
-static const struct table_entry {
-  const char *extension;
-  const char *content_type;
-} content_type_table[] = {
-  { "txt", "text/plain" },
-  { "css", "text/css" },
-  { "js", "application/x-javascript" },
-  { "html", "text/html" },
-  { "htm", "text/htm" },
-  { "gif", "image/gif" },
-  { "jpg", "image/jpeg" },
-  { "jpeg", "image/jpeg" },
-  { "png", "image/png" },
-  { NULL, NULL },
+/**
+ * Everything requests are served with that is built from the configuration. It is replaced
+ * as a whole when the configuration is reloaded, while requests in flight finish with the
+ * snapshot they started with.
+ */
+struct Snapshot {
+  std::unique_ptr<http::MimeTypes> mime_types;
+  std::unique_ptr<http::Site> site;
+  std::unique_ptr<cache::ContentCache> content_cache;
+  std::unique_ptr<cache::FdCache> fd_cache;
+  std::unique_ptr<cache::VariantCache> variant_cache;
+  std::unique_ptr<http::FileHandler> file_handler;
+  std::unique_ptr<http::StatusHandler> status_handler;
+
+  /**
+   * Seconds a client is asked to wait when the server sheds its request
+   */
+  std::string retry_after;
 };
 
-/* Try to guess a good content-type for 'path' */
-static const char* guess_content_type(const char *path) {
-  const char *last_period, *extension;
-  const struct table_entry *ent;
-  last_period = strrchr(path, '.');
-  if (!last_period || strchr(last_period, '/'))
-    goto not_found; /* no exension */
-  
-  extension = last_period + 1;
-  for (ent = &content_type_table[0]; ent->extension; ++ent) {
-    if (!evutil_ascii_strcasecmp(ent->extension, extension))
-      return ent->content_type;
-  }
+static config::Configurator cfg;
+static std::vector<net::Reactor*> reactors;
+static concurrency::Executor* thread_pool = NULL;
+static concurrency::Rcu<Snapshot> snapshot;
+static logging::AccessLog* access_log = NULL;
 
-  not_found:
-    return "text/plain";
-}
+/**
+ * The command line, parsed again on reload
+ */
+static int args_count = 0;
+static char** args = NULL;
 
-void handle_request(evhttp_request *req, void* arg) {
-  std::string document_root = (const char*)arg;
-  document_root = string::utils::chop(document_root, "/");
+/**
+ * Frees the snapshots retired by a reload once no request uses them any more
+ */
+static struct event* collect_timer = NULL;
 
-  struct evbuffer* buf = evhttp_request_get_output_buffer(req);
-    
-  if (!buf) {
+/**
+ * The process started by an upgrade and the event waiting for it to serve, while the
+ * upgrade is under way
+ */
+static pid_t upgrade_pid = -1;
+static struct event* upgrade_event = NULL;
+
+/**
+ * Checks whether the reactors have drained, once they are draining
+ */
+static struct event* drain_timer = NULL;
+
+/**
+ * How long requests in flight are waited for on shutdown, in microseconds, and when the
+ * wait ends
+ */
+static uint64_t drain_timeout = 0;
+static uint64_t drain_deadline = 0;
+
+/**
+ * When draining started, and the requests the reactors had answered and lost by then
+ */
+static uint64_t drain_started = 0;
+static uint64_t completed_before = 0;
+static uint64_t aborted_before = 0;
+
+/**
+ * Sends a response and logs it. The log record is taken before sending, as the request
+ * may be gone afterwards, and the status after, as sending may fail over to an error.
+ * evhttp completes a request from the event loop only, so the trace is still ours then.
+ * @param req the request to answer
+ * @param res the response
+ * @param received the steady time the request arrived, in microseconds
+ * @param trace the trace of the request, may be NULL
+ */
+static void reply(evhttp_request* req, http::Response& res, uint64_t received, metrics::Trace* trace) {
+  if (!access_log) {
+    res.send(req);
+    metrics::Tracer::sent(trace, res.getStatus());
     return;
   }
 
-  const char* request_uri = evhttp_request_get_uri(req);
+  logging::Record* record = access_log->begin(req, received);
+  uint64_t bytes = res.send(req);
+  metrics::Tracer::sent(trace, res.getStatus());
+  access_log->commit(record, res.getStatus(), bytes);
+}
 
-  std::stringstream ss;
-  ss << document_root << request_uri;
-  std::string request_uri_parsed = ss.str();
+/**
+ * Sends a response prepared by a worker on the event loop that owns the request
+ */
+class ReplyCompletion : public net::Completion {
+  protected:
+    evhttp_request* req;
+    http::Response res;
+    uint64_t received;
+    metrics::Trace* trace;
 
-  auto status = HTTP_OK;
+  public:
+    ReplyCompletion(evhttp_request* r, uint64_t t, metrics::Trace* tr) : req(r), res(), received(t), trace(tr) {
+    }
 
-  if (!io::utils::isFile(request_uri_parsed)) {
-    request_uri_parsed = string::utils::chop(cfg.getString("www.errors"), "/") + "/404.html";
-    status = HTTP_NOTFOUND;
+    http::Response& response() {
+      return res;
+    }
 
-    if (!io::utils::isFile(request_uri_parsed)) {
-      evbuffer_add_printf(buf, "404: File not found");
-      evhttp_send_reply(req, status, "Not Found", buf);
-      return;
+    void complete() {
+      reply(req, res, received, trace);
+    }
+};
+
+static void report_stream(const http::StreamReport& report) {
+  std::cout << (report.aborted ? "Aborted" : "Finished") << " stream of " << report.bytes << "/" << report.length
+    << " bytes at " << (uint64_t)(report.seconds > 0 ? report.bytes / report.seconds : 0) << " bytes/s" << std::endl;
+}
+
+/**
+ * Reports a slow request with the time spent in each phase
+ */
+static void report_slow(const metrics::Trace& trace) {
+  // the time from the phase passed before each one, skipping those the request did not pass
+  static const char* names[] = { "accept", "read", "enqueue", "queue", "resolve", "respond", "write" };
+  std::ostringstream phases;
+  uint64_t received = trace.stamps[(int)metrics::Phase::RECEIVED].load(std::memory_order_relaxed);
+  uint64_t last = received;
+  bool first = true;
+
+  for (int i = (int)metrics::Phase::RECEIVED + 1; i < (int)metrics::Phase::COUNT; i++) {
+    uint64_t stamp = trace.stamps[i].load(std::memory_order_relaxed);
+
+    if (stamp) {
+      phases << (first ? ": " : ", ") << names[i] << " " << (stamp - last) / 1000.0;
+      last = stamp;
+      first = false;
     }
   }
 
-  const char* filename = request_uri_parsed.c_str();
-  const char* type = guess_content_type(filename);
-  int file = open(filename, O_RDONLY);
-  
-  evhttp_add_header(evhttp_request_get_output_headers(req), "Content-Type", type);
-  evbuffer_add_file(buf, file, 0, io::utils::filesize(request_uri_parsed));
-  evhttp_send_reply(req, status, "", buf);
+  // a client taking its time to send the first request on a connection is not the server's
+  uint64_t accepted = trace.stamps[(int)metrics::Phase::ACCEPTED].load(std::memory_order_relaxed);
+
+  if (accepted) {
+    phases << " (read " << (received - accepted) / 1000.0 << " ms after accept)";
+  }
+
+  std::cout << "Slow request " << trace.method << " " << trace.uri << " " << trace.status << " in "
+    << (last - received) / 1000.0 << " ms" << phases.str() << std::endl;
+}
+
+/**
+ * Answers the status endpoint on the event loop, if the request is for it
+ * @return true if the request has been answered
+ */
+static bool handle_status(evhttp_request* req, const http::Request& request, uint64_t received,
+    const Snapshot& current) {
+  http::Response res;
+
+  if (!current.status_handler || !current.status_handler->handle(req, request, res)) {
+    return false;
+  }
+
+  reply(req, res, received, request.trace);
+  return true;
+}
+
+/**
+ * Prepares the cheap answer to a request the server has no capacity for
+ */
+static void service_unavailable(const Snapshot& current, http::Response& res) {
+  current.site->error(HTTP_SERVUNAVAIL, res);
+  res.addHeader("Retry-After", current.retry_after);
 }
 
 /*void handle_vhost_cb(evhttp_request* req, void* arg) {
@@ -108,49 +227,624 @@ void handle_request(evhttp_request *req, void* arg) {
   evhttp_send_reply(req, HTTP_OK, "OK", buf);
 }*/
 
-void handle_request_cb(evhttp_request *req, void* arg) {
-  thread_pool.push(handle_request, req, arg);
+/**
+ * Called by evhttp once a response has been written out
+ */
+static void complete_cb(evhttp_request* req, void* arg) {
+  net::Reactor* reactor = net::Reactor::current();
+
+  if (reactor) {
+    reactor->finish(req);
+  }
+
+  metrics::Tracer::complete((uintptr_t)arg);
 }
 
-static void signal_cb(evutil_socket_t fd, short event, void *arg) {
-  struct event_base* base = (struct event_base*)arg;
-  event_base_loopbreak(base);
-  thread_pool.shutdown();
+/**
+ * Starts the trace of a request and counts it as in flight until its response has been
+ * written out
+ * @return the trace, or NULL when not tracing
+ */
+static metrics::Trace* begin(net::Reactor* reactor, evhttp_request* req, uint64_t received) {
+  metrics::Trace* trace = metrics::Tracer::begin(req, reactor->acceptedAt(req), received);
+  reactor->begin(req);
+
+  // the generation travels in the callback argument, so a completion for a recycled slot is told apart
+  evhttp_request_set_on_complete_cb(req, complete_cb, (void*)(uintptr_t)(trace ? trace->generation : 0));
+  return trace;
 }
 
-int main(int argc, char** argv) {
+/**
+ * Hands the close callback of a connection back to its reactor when a stream is done with it
+ */
+static void release_connection(struct evhttp_connection* evcon, bool aborted) {
+  net::Reactor* reactor = net::Reactor::current();
+
+  if (!reactor) {
+    return;
+  }
+
+  if (aborted) {
+    reactor->abort(evcon);
+  } else {
+    reactor->watch(evcon);
+  }
+}
+
+/**
+ * Handles a request to completion on the event loop that accepted it (reactor mode)
+ */
+void handle_request(evhttp_request *req, void* arg) {
+  net::Reactor* reactor = (net::Reactor*)arg;
+  uint64_t received = metrics::now_us();
+  http::Request request(req);
+  request.trace = begin(reactor, req, received);
+
+  concurrency::EpochGuard guard;
+  const Snapshot& current = *snapshot.get();
+
+  if (handle_status(req, request, received, current)) {
+    return;
+  }
+
+  http::Response res;
+  current.file_handler->handle(request, res);
+  metrics::Registry::record(metrics::Timer::SERVICE_TIME, metrics::now_us() - received);
+  reply(req, res, received, request.trace);
+}
+
+/**
+ * Offloads a request to the thread pool (pool mode). The worker only prepares the
+ * response; it is sent from the event loop once the completion is posted back.
+ */
+void handle_request_cb(evhttp_request *req, void* arg) {
+  net::Reactor* reactor = (net::Reactor*)arg;
+  uint64_t received = metrics::now_us();
+  http::Request request(req);
+  request.trace = begin(reactor, req, received);
+
+  concurrency::EpochGuard guard;
+  const Snapshot& current = *snapshot.get();
+
+  if (handle_status(req, request, received, current)) {
+    return;
+  }
+
+  uint64_t enqueued = metrics::now_us();
+  metrics::Tracer::mark(request.trace, metrics::Phase::ENQUEUED);
+
+  // the requests of a connection go to the same workers, with what they touched still in their caches
+  uint64_t key = (uintptr_t)evhttp_request_get_connection(req);
+
+  bool queued = thread_pool->pushFor(key, [reactor, req, request, received, enqueued] {
+    ReplyCompletion* c = new ReplyCompletion(req, received, request.trace);
+    uint64_t started = metrics::now_us();
+    metrics::Registry::record(metrics::Timer::QUEUE_WAIT, started - enqueued);
+    metrics::Tracer::mark(request.trace, metrics::Phase::DEQUEUED);
+
+    // the worker serves with the snapshot current when it picks the request up
+    concurrency::EpochGuard guard;
+    const Snapshot& current = *snapshot.get();
+
+    if (concurrency::Executor::shedding()) {
+      service_unavailable(current, c->response());
+    } else {
+      current.file_handler->handle(request, c->response());
+      metrics::Registry::record(metrics::Timer::SERVICE_TIME, metrics::now_us() - started);
+    }
+
+    reactor->post(c);
+  });
+
+  if (!queued) {
+    http::Response res;
+    service_unavailable(current, res);
+    reply(req, res, received, request.trace);
+  }
+}
+
+/**
+ * Describes the configuration keys and adds the sources they are read from
+ * @param c the configurator to set up
+ */
+static void describe_config(config::Configurator& c) {
   config::ConfigDescriptor cfgdesc;
   
-  // only need to add required values
+  // only need to add required values, with the type and range of those that are not strings
   cfgdesc.add("listen.address", true);
-  cfgdesc.add("listen.port", true);
+  cfgdesc.add("listen.port", true, config::Type::INT, 1, 65535);
   cfgdesc.add("www.root", true);
   cfgdesc.add("www.errors", true);
+  cfgdesc.add("www.etag", true);
+  cfgdesc.add("www.precompressed", true, config::Type::BOOL);
+  cfgdesc.add("server.mode", true);
+  cfgdesc.add("server.reactors", true, config::Type::INT, 0);
+  cfgdesc.add("server.pin_cpu", true, config::Type::BOOL);
+  cfgdesc.add("server.workers", true, config::Type::INT, 0);
+  cfgdesc.add("server.scheduler", true);
+  cfgdesc.add("server.shards", true, config::Type::INT, 0);
+  cfgdesc.add("server.queue_capacity", true, config::Type::INT, 0);
+  cfgdesc.add("server.overflow", true);
+  cfgdesc.add("server.queue_target", true, config::Type::INT, 0);
+  cfgdesc.add("server.queue_interval", true, config::Type::INT, 1);
+  cfgdesc.add("server.retry_after", true, config::Type::INT, 0);
+  cfgdesc.add("server.drain_timeout", true, config::Type::INT, 0);
+  cfgdesc.add("mime.types", true);
+  cfgdesc.add("mime.charset", true);
+  cfgdesc.add("mime.default", true);
+  cfgdesc.add("cache.max_bytes", true, config::Type::INT, 0);
+  cfgdesc.add("cache.max_file_size", true, config::Type::INT, 0);
+  cfgdesc.add("cache.validity", true, config::Type::INT, 0);
+  cfgdesc.add("cache.open_files", true, config::Type::INT, 0);
+  cfgdesc.add("cache.open_file_inactive", true, config::Type::INT, 0);
+  cfgdesc.add("stream.threshold", true, config::Type::INT, 0);
+  cfgdesc.add("stream.window", true, config::Type::INT, 1);
+  cfgdesc.add("stream.high_water", true, config::Type::INT, 0);
+  cfgdesc.add("stream.report", true, config::Type::BOOL);
+  cfgdesc.add("compress.enabled", true, config::Type::BOOL);
+  cfgdesc.add("compress.types", true);
+  cfgdesc.add("compress.min_size", true, config::Type::INT, 0);
+  cfgdesc.add("compress.level", true, config::Type::INT, -1, 9);
+  cfgdesc.add("compress.chunk", true, config::Type::INT, 1);
+  cfgdesc.add("compress.cache_bytes", true, config::Type::INT, 0);
+  cfgdesc.add("compress.max_whole_size", true, config::Type::INT, 0);
+  cfgdesc.add("status.path", true);
+  cfgdesc.add("status.allow", true);
+  cfgdesc.add("log.access", true);
+  cfgdesc.add("log.format", true);
+  cfgdesc.add("log.overflow", true);
+  cfgdesc.add("log.ring_size", true, config::Type::INT, 0);
+  cfgdesc.add("log.flush_interval", true, config::Type::INT, 1);
+  cfgdesc.add("trace.enabled", true, config::Type::BOOL);
+  cfgdesc.add("trace.slow_threshold", true, config::Type::INT, 0);
 
   config::DefaultValueSource* defValues = new config::DefaultValueSource();
   defValues->add("listen.address", "127.0.0.1");
   defValues->add("listen.port", "5555");
   defValues->add("www.root", "htdocs");
   defValues->add("www.errors", "errors");
+  defValues->add("www.etag", "strong");
+  defValues->add("www.precompressed", "false");
+  defValues->add("server.mode", "pool");
+  defValues->add("server.reactors", "0");
+  defValues->add("server.pin_cpu", "false");
+  defValues->add("server.workers", "5");
+  defValues->add("server.scheduler", "queue");
+  defValues->add("server.shards", "0");
+  defValues->add("server.queue_capacity", "65536");
+  defValues->add("server.overflow", "reject");
+  defValues->add("server.queue_target", "0");
+  defValues->add("server.queue_interval", "100");
+  defValues->add("server.retry_after", "1");
+  defValues->add("server.drain_timeout", "30000");
+  defValues->add("mime.types", "/etc/mime.types");
+  defValues->add("mime.charset", "utf-8");
+  defValues->add("mime.default", "text/plain");
+  defValues->add("cache.max_bytes", "0");
+  defValues->add("cache.max_file_size", "262144");
+  defValues->add("cache.validity", "1000");
+  defValues->add("cache.open_files", "0");
+  defValues->add("cache.open_file_inactive", "60000");
+  defValues->add("stream.threshold", "1048576");
+  defValues->add("stream.window", "262144");
+  defValues->add("stream.high_water", "1048576");
+  defValues->add("stream.report", "false");
+  defValues->add("compress.enabled", "false");
+  defValues->add("compress.types", "text/html text/css text/plain application/javascript application/json image/svg+xml");
+  defValues->add("compress.min_size", "1024");
+  defValues->add("compress.level", "6");
+  defValues->add("compress.chunk", "65536");
+  defValues->add("compress.cache_bytes", "16777216");
+  defValues->add("compress.max_whole_size", "262144");
+  defValues->add("status.path", "");
+  defValues->add("status.allow", "127.0.0.1 ::1");
+  defValues->add("log.access", "");
+  defValues->add("log.format", "combined");
+  defValues->add("log.overflow", "drop");
+  defValues->add("log.ring_size", "4096");
+  defValues->add("log.flush_interval", "100");
+  defValues->add("trace.enabled", "true");
+  defValues->add("trace.slow_threshold", "0");
 
   config::CommandlineOptions* cliOpts = new config::CommandlineOptions();
-  cliOpts->addOption(config::Option('a', "The address to bind to", "server.address"));
-  cliOpts->addOption(config::Option('p', "The port to listen on", "server.port"));
+  cliOpts->addOption(config::Option('a', "The address to bind to", "listen.address"));
+  cliOpts->addOption(config::Option('p', "The port to listen on", "listen.port"));
   cliOpts->addOption(config::Option('d', "Document root", "www.root"));
   cliOpts->addOption(config::Option('e', "Error template directory", "www.errors"));
   cliOpts->addOption(config::Option('c', "Path to configuration file", "config.file"));
+  cliOpts->addOption(config::Option('m', "Server mode, either pool or reactor", "server.mode"));
+  cliOpts->addOption(config::Option('r', "Number of reactors in reactor mode, 0 for one per core", "server.reactors"));
+  cliOpts->addOption(config::Option('w', "Number of worker threads in pool mode", "server.workers"));
 
   config::ConfigFile* cfgFile = new config::ConfigFile();
   cfgFile->add("server.address", "listen.address");
   cfgFile->add("server.port", "listen.port");
   cfgFile->add("www.root");
   cfgFile->add("www.errors");
+  cfgFile->add("www.etag");
+  cfgFile->add("www.precompressed");
+  cfgFile->add("server.mode");
+  cfgFile->add("server.reactors");
+  cfgFile->add("server.pin_cpu");
+  cfgFile->add("server.workers");
+  cfgFile->add("server.scheduler");
+  cfgFile->add("server.shards");
+  cfgFile->add("server.queue_capacity");
+  cfgFile->add("server.overflow");
+  cfgFile->add("server.queue_target");
+  cfgFile->add("server.queue_interval");
+  cfgFile->add("server.retry_after");
+  cfgFile->add("server.drain_timeout");
+  cfgFile->add("mime.types");
+  cfgFile->add("mime.charset");
+  cfgFile->add("mime.default");
+  cfgFile->add("cache.max_bytes");
+  cfgFile->add("cache.max_file_size");
+  cfgFile->add("cache.validity");
+  cfgFile->add("cache.open_files");
+  cfgFile->add("cache.open_file_inactive");
+  cfgFile->add("stream.threshold");
+  cfgFile->add("stream.window");
+  cfgFile->add("stream.high_water");
+  cfgFile->add("stream.report");
+  cfgFile->add("compress.enabled");
+  cfgFile->add("compress.types");
+  cfgFile->add("compress.min_size");
+  cfgFile->add("compress.level");
+  cfgFile->add("compress.chunk");
+  cfgFile->add("compress.cache_bytes");
+  cfgFile->add("compress.max_whole_size");
+  cfgFile->add("status.path");
+  cfgFile->add("status.allow");
+  cfgFile->add("log.access");
+  cfgFile->add("log.format");
+  cfgFile->add("log.overflow");
+  cfgFile->add("log.ring_size");
+  cfgFile->add("log.flush_interval");
+  cfgFile->add("trace.enabled");
+  cfgFile->add("trace.slow_threshold");
 
-  cfg.setDescriptor(cfgdesc);
+  c.setDescriptor(cfgdesc);
 
-  cfg.addSource(cliOpts, config::Priority::HIGHEST);
-  cfg.addSource(defValues, config::Priority::LOWEST);
-  cfg.addSource(cfgFile, config::Priority::HIGH);
+  c.addSource(cliOpts, config::Priority::HIGHEST);
+  c.addSource(defValues, config::Priority::LOWEST);
+  c.addSource(cfgFile, config::Priority::HIGH);
+}
+
+/**
+ * Builds what requests are served with from a configuration
+ * @param c the configuration
+ * @return the snapshot, or NULL if it can't be built, after telling why
+ */
+static Snapshot* load_snapshot(config::Configurator& c) {
+  std::unique_ptr<Snapshot> next(new Snapshot());
+  next->retry_after = c.getString("server.retry_after");
+
+  // the caches keep track of precompressed sidecars next to the files they hold
+  bool precompressed = c.getBool("www.precompressed");
+  std::vector<std::string> sidecars;
+
+  if (precompressed) {
+    sidecars = http::FileHandler::sidecarSuffixes();
+  }
+
+  // the content cache is disabled unless it has been given a memory budget
+  if (c.getInt("cache.max_bytes") > 0) {
+    next->content_cache.reset(new cache::ContentCache(c.getInt("cache.max_bytes"), c.getInt("cache.max_file_size"),
+      c.getInt("cache.validity"), sidecars));
+  }
+
+  if (c.getInt("cache.open_files") > 0) {
+    next->fd_cache.reset(new cache::FdCache(c.getInt("cache.open_files"), c.getInt("cache.open_file_inactive"),
+      sidecars));
+
+    if (!next->fd_cache->usable()) {
+      std::cerr << "inotify is not available, open file cache disabled" << std::endl;
+      next->fd_cache.reset();
+    }
+  }
+
+  next->mime_types.reset(new http::MimeTypes(c.getString("mime.charset"), c.getString("mime.default")));
+
+  if (!c.getString("mime.types").empty()) {
+    try {
+      next->mime_types->load(c.getString("mime.types"));
+    } catch (FileNotFoundException& e) {
+      std::cerr << e.what() << ", using the built-in types" << std::endl;
+    }
+  }
+
+  // the directories are resolved and the error pages read once, not per request
+  try {
+    next->site.reset(new http::Site(c.getString("www.root"), c.getString("www.errors"), *next->mime_types));
+  } catch (FileNotFoundException& e) {
+    std::cerr << e.what() << std::endl;
+    return NULL;
+  }
+
+  // the cache opens files the way the site does, so that every mode resolves paths alike
+  http::Site* site = next->site.get();
+  cache::Opener opener = [site](const std::string& path) {
+    return site->open(path);
+  };
+
+  if (next->fd_cache) {
+    next->fd_cache->setOpener(opener);
+    next->fd_cache->setRoot(site->getRoot());
+  }
+
+  next->file_handler.reset(new http::FileHandler(*next->site, *next->mime_types, precompressed,
+    next->content_cache.get(), next->fd_cache.get()));
+
+  if (c.getBool("compress.enabled")) {
+    http::CompressionSettings compression;
+    std::istringstream types(c.getString("compress.types"));
+    std::string type;
+
+    while (types >> type) {
+      compression.types.push_back(type);
+    }
+
+    // small files are compressed once and kept, unless the cache has no memory budget
+    if (c.getInt("compress.cache_bytes") > 0) {
+      next->variant_cache.reset(new cache::VariantCache(c.getInt("compress.cache_bytes")));
+    }
+
+    compression.min_size = c.getInt("compress.min_size");
+    compression.max_whole_size = c.getInt("compress.max_whole_size");
+    compression.variants = next->variant_cache.get();
+    next->file_handler->enableCompression(compression);
+  }
+
+  // the status endpoint is off unless it has been given a path
+  if (!c.getString("status.path").empty()) {
+    std::istringstream addresses(c.getString("status.allow"));
+    std::vector<std::string> allowed;
+    std::string address;
+
+    while (addresses >> address) {
+      allowed.push_back(address);
+    }
+
+    next->status_handler.reset(new http::StatusHandler(c.getString("status.path"), allowed));
+  }
+
+  return next.release();
+}
+
+/**
+ * Reads a value from the current snapshot
+ * @param read reads the value
+ * @return the value
+ */
+static double sample(std::function<double(const Snapshot&)> read) {
+  concurrency::EpochGuard guard;
+  return read(*snapshot.get());
+}
+
+/**
+ * Stops the event loops
+ */
+static void stop(struct event_base* base) {
+  for (net::Reactor* reactor : reactors) {
+    reactor->stop();
+  }
+
+  event_base_loopbreak(base);
+}
+
+/**
+ * Stops once every reactor has answered its requests in flight, or at the deadline
+ */
+static void drain_cb(evutil_socket_t fd, short event, void *arg) {
+  bool drained = true;
+  uint64_t completed = 0;
+  uint64_t aborted = 0;
+  uint64_t inflight = 0;
+
+  for (net::Reactor* reactor : reactors) {
+    drained = drained && reactor->isDrained();
+    completed += reactor->getCompleted();
+    aborted += reactor->getAborted();
+    inflight += reactor->getInflight();
+  }
+
+  uint64_t now = metrics::now_us();
+
+  if (!drained && now < drain_deadline) {
+    struct timeval delay = { 0, 50000 };
+    evtimer_add(drain_timer, &delay);
+    return;
+  }
+
+  std::cout << (drained ? "Drained" : "Drain deadline reached") << " after " << (now - drain_started) / 1000
+    << " ms: " << completed - completed_before << " requests completed, " << aborted - aborted_before << " lost";
+
+  if (!drained) {
+    std::cout << ", " << inflight << " cut off";
+  }
+
+  std::cout << std::endl;
+  stop((struct event_base*)arg);
+}
+
+/**
+ * Stops accepting and keeping connections alive, and stops once the requests in flight
+ * have been answered or the drain timeout has passed
+ */
+static void start_drain(struct event_base* base) {
+  for (net::Reactor* reactor : reactors) {
+    completed_before += reactor->getCompleted();
+    aborted_before += reactor->getAborted();
+    reactor->drain();
+  }
+
+  drain_started = metrics::now_us();
+  drain_deadline = drain_started + drain_timeout;
+  drain_timer = evtimer_new(base, drain_cb, base);
+
+  // the reactors stop accepting on their own threads, give them a moment
+  struct timeval delay = { 0, 1000 };
+  evtimer_add(drain_timer, &delay);
+}
+
+/**
+ * Drains and stops, or stops right away if a drain is already under way
+ */
+static void signal_cb(evutil_socket_t fd, short event, void *arg) {
+  struct event_base* base = (struct event_base*)arg;
+
+  if (drain_timer) {
+    std::cout << "Stopping without waiting for requests in flight" << std::endl;
+    stop(base);
+    return;
+  }
+
+  std::cout << "Shutting down" << std::endl;
+  start_drain(base);
+}
+
+/**
+ * Learns whether the process started by an upgrade serves. Once it does, this one drains.
+ */
+static void ready_cb(evutil_socket_t fd, short event, void *arg) {
+  char byte;
+  ssize_t n = read(fd, &byte, 1);
+
+  event_free(upgrade_event);
+  upgrade_event = NULL;
+  close(fd);
+
+  if (n != 1) {
+    // the new process exited, or could not be started, before it served
+    waitpid(upgrade_pid, NULL, WNOHANG);
+    upgrade_pid = -1;
+    std::cerr << "Upgrade failed, still serving" << std::endl;
+    return;
+  }
+
+  std::cout << "Process " << upgrade_pid << " serves, draining" << std::endl;
+  start_drain((struct event_base*)arg);
+}
+
+/**
+ * Starts the binary at the command line again, handing it the listening sockets
+ */
+static void upgrade_cb(evutil_socket_t fd, short event, void *arg) {
+  struct event_base* base = (struct event_base*)arg;
+
+  if (upgrade_event || drain_timer) {
+    std::cerr << "An upgrade is already under way" << std::endl;
+    return;
+  }
+
+  std::vector<int> sockets;
+
+  for (net::Reactor* reactor : reactors) {
+    for (int socket : reactor->getSockets()) {
+      sockets.push_back(socket);
+    }
+  }
+
+  int ready = -1;
+
+  try {
+    upgrade_pid = net::Upgrade::spawn(args, sockets, &ready);
+  } catch (IOException& e) {
+    std::cerr << e.what() << std::endl;
+    return;
+  }
+
+  std::cout << "Upgrading to process " << upgrade_pid << std::endl;
+
+  upgrade_event = event_new(base, ready, EV_READ, ready_cb, base);
+  event_add(upgrade_event, NULL);
+}
+
+/**
+ * Reopens the access log, after logrotate has moved it away
+ */
+static void reopen_cb(evutil_socket_t fd, short event, void *arg) {
+  if (access_log) {
+    access_log->reopen();
+  }
+}
+
+/**
+ * Arms the timer that frees retired snapshots
+ */
+static void schedule_collect() {
+  struct timeval delay = { 0, 100000 };
+  evtimer_add(collect_timer, &delay);
+}
+
+/**
+ * Frees the retired snapshots, trying again later while requests still use some
+ */
+static void collect_cb(evutil_socket_t fd, short event, void *arg) {
+  if (concurrency::Epochs::collect() > 0) {
+    schedule_collect();
+  }
+}
+
+/**
+ * Reads the configuration again and swaps in a snapshot built from it. Requests already
+ * being handled finish with the previous snapshot, which is freed after them. If the new
+ * configuration can't be read or used, the current one stays in place.
+ */
+static void reload_cb(evutil_socket_t fd, short event, void *arg) {
+  // logrotate sends SIGHUP as well
+  if (access_log) {
+    access_log->reopen();
+  }
+
+  config::Configurator next;
+  describe_config(next);
+
+  try {
+    if (next.parse(args_count, args) == 1) {
+      std::cerr << "Reload failed, keeping the current configuration" << std::endl;
+      return;
+    }
+  } catch (BaseException& e) {
+    std::cerr << e.what() << std::endl;
+    std::cerr << "Reload failed, keeping the current configuration" << std::endl;
+    return;
+  }
+
+  Snapshot* loaded = load_snapshot(next);
+
+  if (!loaded) {
+    std::cerr << "Reload failed, keeping the current configuration" << std::endl;
+    return;
+  }
+
+  for (const char* key : { "listen.address", "listen.port", "server.mode", "server.reactors", "server.pin_cpu",
+    "server.workers", "server.scheduler", "server.shards", "server.queue_capacity", "server.overflow",
+    "server.queue_target", "server.queue_interval", "server.drain_timeout", "stream.threshold", "stream.window",
+    "stream.high_water", "stream.report", "log.access", "log.format", "log.overflow", "log.ring_size",
+    "log.flush_interval", "trace.enabled", "trace.slow_threshold", "www.etag", "compress.level", "compress.chunk" }) {
+    if (next.getString(key) != cfg.getString(key)) {
+      std::cerr << "Changing " << key << " takes effect after a restart" << std::endl;
+    }
+  }
+
+  snapshot.publish(loaded);
+  std::cout << "Configuration reloaded" << std::endl;
+
+  schedule_collect();
+}
+
+int main(int argc, char** argv) {
+  // before any thread is started, as it changes the environment
+  std::vector<int> inherited = net::Upgrade::inherited();
+
+  // a client that goes away makes writes to it fail, which must not stop the server
+  signal(SIGPIPE, SIG_IGN);
+
+  args_count = argc;
+  args = argv;
+  describe_config(cfg);
 
   try {
     if (cfg.parse(argc, argv) == 1) {
@@ -173,56 +867,366 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  thread_pool.start();
-  
+  std::string mode = cfg.getString("server.mode");
+  bool reactor_mode = mode == "reactor";
+
+  if (!reactor_mode && mode != "pool") {
+    std::cerr << "Unknown server mode " << mode << std::endl;
+    return 1;
+  }
+
+  // in pool mode a single event loop hands every request to the thread pool,
+  // in reactor mode every loop runs its requests to completion itself
+  int reactor_count = 1;
+  int cpus = std::thread::hardware_concurrency();
+
+  if (reactor_mode) {
+    reactor_count = cfg.getInt("server.reactors");
+
+    if (reactor_count <= 0) {
+      reactor_count = cpus > 0 ? cpus : 1;
+    }
+  }
+
   evthread_use_pthreads();
 
-  struct event_base* base;
-  struct evhttp* http;
+  http::FileStream::configure(cfg.getInt("stream.threshold"), cfg.getInt("stream.window"),
+    cfg.getInt("stream.high_water"));
+
+  if (cfg.getBool("stream.report")) {
+    http::FileStream::setReporter(report_stream);
+  }
+
+  std::string etag = cfg.getString("www.etag");
+
+  if (etag == "strong") {
+    http::Validators::configure(http::ETagMode::STRONG);
+  } else if (etag == "weak") {
+    http::Validators::configure(http::ETagMode::WEAK);
+  } else if (etag == "content") {
+    http::Validators::configure(http::ETagMode::CONTENT);
+  } else if (etag == "none") {
+    http::Validators::configure(http::ETagMode::NONE);
+  } else {
+    std::cerr << "Unknown ETag mode " << etag << std::endl;
+    return 1;
+  }
+
+  http::Compressor::configure(cfg.getInt("compress.level"));
+  http::CompressedStream::configure(cfg.getInt("compress.chunk"));
+
+  Snapshot* first = load_snapshot(cfg);
+
+  if (!first) {
+    return 1;
+  }
+
+  snapshot.publish(first);
 
-  base = event_base_new();
+  // the access log is off unless it has been given a file
+  std::unique_ptr<logging::AccessLog> access;
+
+  if (!cfg.getString("log.access").empty()) {
+    std::string format = cfg.getString("log.format");
+    std::string overflow = cfg.getString("log.overflow");
+
+    if (format != "combined" && format != "json") {
+      std::cerr << "Unknown access log format " << format << std::endl;
+      return 1;
+    }
+
+    if (overflow != "drop" && overflow != "block") {
+      std::cerr << "Unknown access log overflow policy " << overflow << std::endl;
+      return 1;
+    }
+
+    int ring_size = cfg.getInt("log.ring_size");
+
+    try {
+      access.reset(new logging::AccessLog(cfg.getString("log.access"),
+        format == "json" ? logging::Format::JSON : logging::Format::COMBINED,
+        overflow == "block" ? logging::Overflow::BLOCK : logging::Overflow::DROP, ring_size > 0 ? ring_size : 4096,
+        std::chrono::milliseconds(cfg.getInt("log.flush_interval"))));
+    } catch (IOException& e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+
+    access->start();
+    access_log = access.get();
+
+    logging::AccessLog* logger = access_log;
+    metrics::Registry::addSampled("access_log_dropped_total", "Access log records dropped because a ring was full",
+      true, [logger] {
+        return (double)logger->dropped();
+      });
+  }
+
+  bool tracing = cfg.getBool("trace.enabled");
+  metrics::Tracer::configure(tracing, (uint64_t)cfg.getInt("trace.slow_threshold") * 1000);
+  metrics::Tracer::setReporter(report_slow);
+  http::Response::setReleaseHandler(release_connection);
+
+  try {
+    for (int i = 0; i < reactor_count; i++) {
+      net::Reactor* reactor = new net::Reactor(i);
+      reactors.push_back(reactor);
+
+      evhttp_set_allowed_methods(reactor->getHttp(), EVHTTP_REQ_GET);
+      reactor->setCallback(reactor_mode ? handle_request : handle_request_cb, reactor);
+
+      // sockets handed down by an upgrade are shared out, reactors left without one bind their own
+      bool adopted = false;
+
+      for (size_t k = i; k < inherited.size(); k += reactor_count) {
+        reactor->adopt(inherited[k]);
+        adopted = true;
+      }
+
+      if (!adopted) {
+        reactor->bind(cfg.getString("listen.address"), cfg.getInt("listen.port"));
+      }
+
+      if (tracing) {
+        reactor->trackAccepts();
+      }
+
+      if (cfg.getBool("server.pin_cpu") && cpus > 0) {
+        reactor->pin(i % cpus);
+      }
+    }
+  } catch (IOException& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  // the main thread only waits for signals, and frees what reloads leave behind
+  struct event_base* base = event_base_new();
 
   if (!base) {
     std::cerr << "Failed to create event base." << std::endl;
     return 1;
   }
 
+  collect_timer = evtimer_new(base, collect_cb, NULL);
+
   struct event* signal_int = evsignal_new(base, SIGINT, signal_cb, base);
   event_add(signal_int, NULL);
 
-  http = evhttp_new(base);
+  struct event* signal_term = evsignal_new(base, SIGTERM, signal_cb, base);
+  event_add(signal_term, NULL);
 
-  if (!http) {
-    std::cerr << "Failed to create http server" << std::endl;
-    return 1;
-  }
+  struct event* signal_hup = evsignal_new(base, SIGHUP, reload_cb, NULL);
+  event_add(signal_hup, NULL);
 
-  const char* document_root = cfg.getString("www.root").c_str();
+  struct event* signal_usr1 = evsignal_new(base, SIGUSR1, reopen_cb, NULL);
+  event_add(signal_usr1, NULL);
 
-  evhttp_set_allowed_methods(http, EVHTTP_REQ_GET);
-  evhttp_set_gencb(http, handle_request_cb, (void*)(document_root));
+  struct event* signal_usr2 = evsignal_new(base, SIGUSR2, upgrade_cb, base);
+  event_add(signal_usr2, NULL);
 
-  // vhost
-  /*struct evhttp* vhost = evhttp_new(base);
-  evhttp_set_allowed_methods(vhost, EVHTTP_REQ_GET);
-  evhttp_set_gencb(vhost, handle_vhost_cb, (void*)(document_root));
+  drain_timeout = (uint64_t)cfg.getInt("server.drain_timeout") * 1000;
 
-  evhttp_add_virtual_host(http, "cdn.example.com", vhost);*/
+  int workers = cfg.getInt("server.workers");
+  std::string scheduler = cfg.getString("server.scheduler");
 
-  if (evhttp_bind_socket(http, cfg.getString("listen.address").c_str(), cfg.getInt("listen.port")) == -1) {
-    std::cerr << "Failed to bind to address." << std::endl;
-    return 1;
+  int queue_capacity = cfg.getInt("server.queue_capacity");
+  std::string overflow = cfg.getString("server.overflow");
+
+  if (!reactor_mode) {
+    if (scheduler == "stealing") {
+      // the injection queue is always bounded
+      thread_pool = new concurrency::WorkStealingPool(workers > 0 ? workers : 1,
+        queue_capacity > 0 ? queue_capacity : 65536, false);
+    } else if (scheduler == "sharded") {
+      // one shard per core by default, as long as there are workers for them
+      int shards = cfg.getInt("server.shards");
+      int pool_workers = workers > 0 ? workers : 1;
+
+      if (shards <= 0) {
+        shards = std::min(cpus > 0 ? cpus : 1, pool_workers);
+      } else if (shards > pool_workers) {
+        std::cerr << "Using " << pool_workers << " shards instead of " << shards << ", a shard needs a worker"
+          << std::endl;
+        shards = pool_workers;
+      }
+
+      // pinned workers stay off the CPUs of the event loops
+      std::vector<int> reserved;
+
+      for (int i = 0; i < reactor_count && cpus > 0; i++) {
+        reserved.push_back(i % cpus);
+      }
+
+      thread_pool = new concurrency::ShardedPool(pool_workers, shards, queue_capacity > 0 ? queue_capacity : 0, false,
+        cfg.getBool("server.pin_cpu"), reserved);
+    } else if (scheduler == "queue") {
+      thread_pool = new concurrency::ThreadPool(workers > 0 ? workers : 1, queue_capacity > 0 ? queue_capacity : 0,
+        false);
+    } else {
+      std::cerr << "Unknown scheduler " << scheduler << std::endl;
+      return 1;
+    }
+
+    if (overflow == "reject") {
+      thread_pool->setOverflow(concurrency::Overflow::REJECT);
+    } else if (overflow == "block") {
+      thread_pool->setOverflow(concurrency::Overflow::BLOCK);
+    } else if (overflow == "drop_oldest") {
+      thread_pool->setOverflow(concurrency::Overflow::DROP_OLDEST);
+    } else {
+      std::cerr << "Unknown overflow policy " << overflow << std::endl;
+      return 1;
+    }
+
+    thread_pool->setDelayTarget(std::chrono::milliseconds(cfg.getInt("server.queue_target")),
+      std::chrono::milliseconds(cfg.getInt("server.queue_interval")));
+    thread_pool->start();
+
+    metrics::Registry::addSampled("queue_length", "Requests waiting for a worker", false, [] {
+      return (double)thread_pool->stats().queued;
+    });
+    metrics::Registry::addSampled("workers_active", "Workers handling a request", false, [] {
+      return (double)thread_pool->stats().active;
+    });
+    metrics::Registry::addSampled("rejected_total", "Requests rejected because the queue was full", true, [] {
+      return (double)thread_pool->stats().rejected;
+    });
+    metrics::Registry::addSampled("dropped_total", "Queued requests dropped for newer ones", true, [] {
+      return (double)thread_pool->stats().dropped;
+    });
+    metrics::Registry::addSampled("shed_total", "Requests shed because they waited too long", true, [] {
+      return (double)thread_pool->stats().shed;
+    });
   }
 
-  std::cout << "Starting server on " << cfg.getString("listen.address") << ":" << cfg.getInt("listen.port") << std::endl;
-  
+  // the caches are sampled through the snapshot, as a reload replaces them
+  metrics::Registry::addSampled("content_cache_hits_total", "Content cache hits", true, [] {
+    return sample([](const Snapshot& s) {
+      return s.content_cache ? (double)s.content_cache->stats().hits : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("content_cache_misses_total", "Content cache misses", true, [] {
+    return sample([](const Snapshot& s) {
+      return s.content_cache ? (double)s.content_cache->stats().misses : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("content_cache_bytes", "Bytes held by the content cache", false, [] {
+    return sample([](const Snapshot& s) {
+      return s.content_cache ? (double)s.content_cache->stats().bytes : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("fd_cache_hits_total", "Open file cache hits", true, [] {
+    return sample([](const Snapshot& s) {
+      return s.fd_cache ? (double)s.fd_cache->stats().hits : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("fd_cache_misses_total", "Open file cache misses", true, [] {
+    return sample([](const Snapshot& s) {
+      return s.fd_cache ? (double)s.fd_cache->stats().misses : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("fd_cache_entries", "Files held open by the open file cache", false, [] {
+    return sample([](const Snapshot& s) {
+      return s.fd_cache ? (double)s.fd_cache->stats().entries : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("compressed_cache_hits_total", "Compressed cache hits", true, [] {
+    return sample([](const Snapshot& s) {
+      return s.variant_cache ? (double)s.variant_cache->stats().hits : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("compressed_cache_misses_total", "Compressed cache misses", true, [] {
+    return sample([](const Snapshot& s) {
+      return s.variant_cache ? (double)s.variant_cache->stats().misses : 0.0;
+    });
+  });
+  metrics::Registry::addSampled("compressed_cache_bytes", "Bytes held by the compressed cache", false, [] {
+    return sample([](const Snapshot& s) {
+      return s.variant_cache ? (double)s.variant_cache->stats().bytes : 0.0;
+    });
+  });
+
+  std::cout << "Starting server on " << cfg.getString("listen.address") << ":" << cfg.getInt("listen.port")
+    << " (" << mode << " mode, " << reactor_count << " event loop" << (reactor_count > 1 ? "s" : "") << ")" << std::endl;
+
+  if (!inherited.empty()) {
+    std::cout << "Listening on " << inherited.size() << " inherited socket" << (inherited.size() > 1 ? "s" : "")
+      << std::endl;
+  }
+
+  for (net::Reactor* reactor : reactors) {
+    reactor->start();
+  }
+
+  net::Upgrade::ready();
+
   if (event_base_dispatch(base) == -1) {
     std::cerr << "Failed to start event thread." << std::endl;
     return -1;
   }
 
-  evhttp_free(http);
+  for (net::Reactor* reactor : reactors) {
+    reactor->join();
+  }
+
+  // workers may still post completions, so stop them before the reactors go away
+  if (thread_pool) {
+    thread_pool->shutdown();
+
+    concurrency::ExecutorStats stats = thread_pool->stats();
+    std::cout << "Thread pool: " << stats.queued << " queued, " << stats.rejected << " rejected, "
+      << stats.dropped << " dropped, " << stats.shed << " shed" << std::endl;
+
+    delete thread_pool;
+  }
+
+  for (net::Reactor* reactor : reactors) {
+    delete reactor;
+  }
+
+  // every request has completed, so the snapshots retired by reloads can all go
+  concurrency::Epochs::collect();
+  const Snapshot& last = *snapshot.get();
+
+  if (last.content_cache) {
+    cache::ContentCacheStats stats = last.content_cache->stats();
+    std::cout << "Content cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+      << stats.evictions << " evictions, " << stats.entries << " files in " << stats.bytes << " bytes" << std::endl;
+  }
+
+  if (last.fd_cache) {
+    cache::FdCacheStats stats = last.fd_cache->stats();
+    std::cout << "Open file cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+      << stats.invalidations << " invalidations, " << stats.entries << " open files" << std::endl;
+  }
+
+  if (last.variant_cache) {
+    cache::VariantCacheStats stats = last.variant_cache->stats();
+    std::cout << "Compressed cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+      << stats.evictions << " evictions, " << stats.entries << " files in " << stats.bytes << " bytes" << std::endl;
+  }
+
+  if (access && access->dropped() > 0) {
+    std::cout << "Access log: " << access->dropped() << " records dropped" << std::endl;
+  }
+
+  event_free(signal_int);
+  event_free(signal_term);
+  event_free(signal_hup);
+  event_free(signal_usr1);
+  event_free(signal_usr2);
+  event_free(collect_timer);
+
+  if (drain_timer) {
+    event_free(drain_timer);
+  }
+
+  if (upgrade_event) {
+    close(event_get_fd(upgrade_event));
+    event_free(upgrade_event);
+  }
   event_base_free(base);
 
   return 0;
-}
\ No newline at end of file
+}
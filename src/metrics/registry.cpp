@@ -0,0 +1,274 @@
+#include <metrics/registry.hpp>
+
+#include <sstream>
+#include <iomanip>
+#include <new>
+#include <cstdlib>
+
+std::mutex metrics::Registry::mutex;
+std::vector<metrics::Shard*> metrics::Registry::shards;
+std::vector<metrics::Sampled> metrics::Registry::sampled;
+
+static const int TIMERS = (int)metrics::Timer::COUNT;
+static const char* TIMER_NAMES[] = { "queue_wait", "service_time", "phase_read", "phase_resolve", "phase_respond",
+  "phase_write", "request" };
+static const char* TIMER_HELP[] = {
+  "Time requests waited in the worker queue",
+  "Time spent handling requests, from taking them off the queue to the response being ready",
+  "Time from accepting a connection to having read its first request",
+  "Time from starting to handle a request to having resolved its file",
+  "Time from having resolved the file to handing the response to the event loop",
+  "Time from handing the response to the event loop to having written it out",
+  "Time from having read a request to having written out its response"
+};
+
+metrics::Histogram::Histogram() : sum(0) {
+  for (auto& count : counts) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+
+int metrics::Histogram::bucket(uint64_t value) {
+  if (value < SUB_BUCKETS) {
+    return value;
+  }
+
+  // values in [2^e, 2^(e+1)) fall into four buckets of width 2^(e-2)
+  int e = 63 - __builtin_clzll(value);
+  int bucket = (e - 1) * SUB_BUCKETS + (int)(value >> (e - 2)) - SUB_BUCKETS;
+  return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t metrics::Histogram::upperBound(int bucket) {
+  if (bucket < SUB_BUCKETS) {
+    return bucket + 1;
+  }
+
+  int e = bucket / SUB_BUCKETS + 1;
+  int sub = bucket % SUB_BUCKETS;
+  return (uint64_t)(SUB_BUCKETS + sub + 1) << (e - 2);
+}
+
+uint64_t metrics::Histogram::collect(uint64_t* buckets) const {
+  for (int i = 0; i < BUCKETS; i++) {
+    buckets[i] += counts[i].load(std::memory_order_relaxed);
+  }
+
+  return sum.load(std::memory_order_relaxed);
+}
+
+metrics::Shard::Shard() : bytes_out(0) {
+  for (auto& count : requests) {
+    count.store(0, std::memory_order_relaxed);
+  }
+}
+
+metrics::Shard& metrics::Registry::local() {
+  static thread_local Shard* shard = nullptr;
+
+  if (!shard) {
+    // operator new only guarantees the alignment of fundamental types before C++17
+    void* memory = nullptr;
+
+    if (posix_memalign(&memory, alignof(Shard), sizeof(Shard)) != 0) {
+      throw std::bad_alloc();
+    }
+
+    shard = new(memory) Shard();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    shards.push_back(shard);
+  }
+
+  return *shard;
+}
+
+/**
+ * Returns the slot a status is counted in
+ */
+static int status_slot(int status) {
+  for (int i = 0; i < metrics::STATUS_SLOTS - 1; i++) {
+    if (metrics::STATUSES[i] == status) {
+      return i;
+    }
+  }
+
+  return metrics::STATUS_SLOTS - 1;
+}
+
+/**
+ * Adds to a counter only the calling thread writes to
+ */
+static void bump(std::atomic<uint64_t>& counter, uint64_t n) {
+  counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+void metrics::Registry::countResponse(int status, uint64_t bytes) {
+  Shard& shard = local();
+  bump(shard.requests[status_slot(status)], 1);
+  bump(shard.bytes_out, bytes);
+}
+
+void metrics::Registry::countBytes(uint64_t bytes) {
+  bump(local().bytes_out, bytes);
+}
+
+void metrics::Registry::record(Timer timer, uint64_t us) {
+  local().timers[(int)timer].record(us);
+}
+
+void metrics::Registry::addSampled(const std::string& name, const std::string& help, bool counter,
+    std::function<double()> read) {
+  std::lock_guard<std::mutex> lock(mutex);
+  sampled.push_back(Sampled{ name, help, counter, read });
+}
+
+void metrics::Registry::collect(uint64_t* requests, uint64_t& bytes_out, uint64_t (*timers)[Histogram::BUCKETS],
+    uint64_t* timer_sums) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (const Shard* shard : shards) {
+    for (int i = 0; i < STATUS_SLOTS; i++) {
+      requests[i] += shard->requests[i].load(std::memory_order_relaxed);
+    }
+
+    bytes_out += shard->bytes_out.load(std::memory_order_relaxed);
+
+    for (int i = 0; i < TIMERS; i++) {
+      timer_sums[i] += shard->timers[i].collect(timers[i]);
+    }
+  }
+}
+
+/**
+ * Returns the label of a status slot
+ */
+static std::string status_label(int slot) {
+  return slot < metrics::STATUS_SLOTS - 1 ? std::to_string(metrics::STATUSES[slot]) : "other";
+}
+
+std::string metrics::Registry::prometheus() {
+  uint64_t requests[STATUS_SLOTS] = {};
+  uint64_t bytes_out = 0;
+  uint64_t timers[TIMERS][Histogram::BUCKETS] = {};
+  uint64_t timer_sums[TIMERS] = {};
+  collect(requests, bytes_out, timers, timer_sums);
+
+  std::ostringstream out;
+  out << std::setprecision(12);
+
+  out << "# HELP salthttpd_requests_total Responses sent, by status\n";
+  out << "# TYPE salthttpd_requests_total counter\n";
+
+  for (int i = 0; i < STATUS_SLOTS; i++) {
+    out << "salthttpd_requests_total{status=\"" << status_label(i) << "\"} " << requests[i] << "\n";
+  }
+
+  out << "# HELP salthttpd_bytes_out_total Response body bytes sent\n";
+  out << "# TYPE salthttpd_bytes_out_total counter\n";
+  out << "salthttpd_bytes_out_total " << bytes_out << "\n";
+
+  // the exposition has a bucket per power of two, which is a boundary of the fine buckets. The
+  // bounds of those are exclusive while "le" is inclusive, so, durations being whole
+  // microseconds, each is labelled with the largest duration it holds
+  for (int t = 0; t < TIMERS; t++) {
+    std::string name = std::string("salthttpd_") + TIMER_NAMES[t] + "_seconds";
+    out << "# HELP " << name << " " << TIMER_HELP[t] << "\n";
+    out << "# TYPE " << name << " histogram\n";
+
+    uint64_t cumulative = 0;
+
+    for (int i = 0; i < Histogram::BUCKETS; i++) {
+      cumulative += timers[t][i];
+      uint64_t bound = Histogram::upperBound(i);
+
+      if ((bound & (bound - 1)) == 0) {
+        out << name << "_bucket{le=\"" << (bound - 1) / 1e6 << "\"} " << cumulative << "\n";
+      }
+    }
+
+    out << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n";
+    out << name << "_sum " << timer_sums[t] / 1e6 << "\n";
+    out << name << "_count " << cumulative << "\n";
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (const Sampled& value : sampled) {
+    std::string name = "salthttpd_" + value.name;
+    out << "# HELP " << name << " " << value.help << "\n";
+    out << "# TYPE " << name << " " << (value.counter ? "counter" : "gauge") << "\n";
+    out << name << " " << value.read() << "\n";
+  }
+
+  return out.str();
+}
+
+/**
+ * Returns the upper bound of the bucket a percentile falls into
+ */
+static uint64_t percentile(const uint64_t* buckets, uint64_t count, double p) {
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t rank = (uint64_t)(p / 100 * count + 0.5);
+  uint64_t seen = 0;
+
+  for (int i = 0; i < metrics::Histogram::BUCKETS; i++) {
+    seen += buckets[i];
+
+    if (seen >= rank && seen > 0) {
+      return metrics::Histogram::upperBound(i);
+    }
+  }
+
+  return metrics::Histogram::upperBound(metrics::Histogram::BUCKETS - 1);
+}
+
+std::string metrics::Registry::json() {
+  uint64_t requests[STATUS_SLOTS] = {};
+  uint64_t bytes_out = 0;
+  uint64_t timers[TIMERS][Histogram::BUCKETS] = {};
+  uint64_t timer_sums[TIMERS] = {};
+  collect(requests, bytes_out, timers, timer_sums);
+
+  std::ostringstream out;
+  out << std::setprecision(12);
+  out << "{\"requests\":{";
+
+  for (int i = 0; i < STATUS_SLOTS; i++) {
+    out << (i ? "," : "") << "\"" << status_label(i) << "\":" << requests[i];
+  }
+
+  out << "},\"bytes_out\":" << bytes_out;
+
+  for (int t = 0; t < TIMERS; t++) {
+    uint64_t count = 0;
+
+    for (int i = 0; i < Histogram::BUCKETS; i++) {
+      count += timers[t][i];
+    }
+
+    out << ",\"" << TIMER_NAMES[t] << "_us\":{\"count\":" << count
+      << ",\"mean\":" << (count ? (double)timer_sums[t] / count : 0.0);
+
+    const double percentiles[] = { 50, 90, 99, 99.9 };
+    const char* labels[] = { "p50", "p90", "p99", "p999" };
+
+    for (int i = 0; i < 4; i++) {
+      out << ",\"" << labels[i] << "\":" << percentile(timers[t], count, percentiles[i]);
+    }
+
+    out << "}";
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (const Sampled& value : sampled) {
+    out << ",\"" << value.name << "\":" << value.read();
+  }
+
+  out << "}\n";
+  return out.str();
+}
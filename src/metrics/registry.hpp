@@ -0,0 +1,192 @@
+#ifndef REGISTRY_HPP
+#define REGISTRY_HPP
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+namespace metrics {
+  /**
+   * Returns a steady timestamp in microseconds, the clock all request timings are taken with
+   */
+  inline uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /**
+   * The statuses requests are counted by, anything else is counted as "other"
+   */
+  static const int STATUSES[] = { 200, 206, 304, 400, 403, 404, 405, 416, 500, 503 };
+  static const int STATUS_SLOTS = sizeof(STATUSES) / sizeof(STATUSES[0]) + 1;
+
+  /**
+   * A latency histogram with log-linear buckets: four per power of two, from one microsecond
+   * up to about half an hour. A histogram belongs to one thread, which is its only writer,
+   * so recording is a few plain loads and stores; readers add up the histograms of all threads.
+   */
+  class Histogram {
+    public:
+      static const int SUB_BUCKETS = 4;
+      static const int BUCKETS = 32 * SUB_BUCKETS;
+
+    protected:
+      std::atomic<uint64_t> counts[BUCKETS];
+      std::atomic<uint64_t> sum;
+
+      static void add(std::atomic<uint64_t>& counter, uint64_t n) {
+        counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+      }
+
+    public:
+      Histogram();
+
+      /**
+       * Returns the bucket of a value
+       */
+      static int bucket(uint64_t value);
+
+      /**
+       * Returns the smallest value that no longer falls into a bucket
+       */
+      static uint64_t upperBound(int bucket);
+
+      /**
+       * Records a value. Must only be called by the owning thread.
+       * @param value the value in microseconds
+       */
+      void record(uint64_t value) {
+        add(counts[bucket(value)], 1);
+        add(sum, value);
+      }
+
+      /**
+       * Adds the counts of this histogram to the given buckets
+       * @param buckets BUCKETS counts to add to
+       * @return the sum of the recorded values
+       */
+      uint64_t collect(uint64_t* buckets) const;
+  };
+
+  /**
+   * The histograms every thread keeps
+   */
+  enum class Timer {
+    QUEUE_WAIT,
+    SERVICE_TIME,
+
+    /**
+     * The phases of a traced request: accepting the connection to having read the request,
+     * starting to handle it to having resolved its file, from there to handing the response
+     * to the event loop, writing it out, and the whole request
+     */
+    READ,
+    RESOLVE,
+    RESPOND,
+    WRITE,
+    TOTAL,
+    COUNT
+  };
+
+  /**
+   * The metrics of one thread, padded to cache lines so that threads never share one
+   */
+  struct alignas(64) Shard {
+    std::atomic<uint64_t> requests[STATUS_SLOTS];
+    std::atomic<uint64_t> bytes_out;
+    Histogram timers[(int)Timer::COUNT];
+
+    Shard();
+  };
+
+  /**
+   * A value read from elsewhere when the metrics are exported, such as a queue length
+   */
+  struct Sampled {
+    std::string name;
+    std::string help;
+    bool counter;
+    std::function<double()> read;
+  };
+
+  /**
+   * The Registry keeps the server metrics. Hot-path events are counted in per-thread shards
+   * without locks or shared cache lines and added up when the metrics are read; values that
+   * are kept elsewhere anyway, such as cache statistics, are registered as sampled values.
+   * The metrics are exported in the Prometheus text format or as JSON.
+   */
+  class Registry {
+    protected:
+      /**
+       * Guards the list of shards and sampled values, taken when a thread registers its
+       * shard and when the metrics are read
+       */
+      static std::mutex mutex;
+
+      /**
+       * The shards of all threads that ever recorded a metric. Shards outlive their threads,
+       * so that counters never go backwards.
+       */
+      static std::vector<Shard*> shards;
+
+      static std::vector<Sampled> sampled;
+
+      /**
+       * Returns the shard of the calling thread, creating it on first use
+       */
+      static Shard& local();
+
+      /**
+       * Adds up the shards
+       */
+      static void collect(uint64_t* requests, uint64_t& bytes_out, uint64_t (*timers)[Histogram::BUCKETS],
+        uint64_t* timer_sums);
+
+    public:
+      /**
+       * Counts a response
+       * @param status the status code
+       * @param bytes the number of body bytes sent
+       */
+      static void countResponse(int status, uint64_t bytes);
+
+      /**
+       * Counts body bytes sent after the response was started, such as compressed chunks
+       * @param bytes the number of bytes
+       */
+      static void countBytes(uint64_t bytes);
+
+      /**
+       * Records a duration
+       * @param timer the histogram to record to
+       * @param us the duration in microseconds
+       */
+      static void record(Timer timer, uint64_t us);
+
+      /**
+       * Registers a value that is read when the metrics are exported. Must be called before
+       * the metrics are read for the first time.
+       * @param name the metric name, without the salthttpd_ prefix
+       * @param help the description of the metric
+       * @param counter true for a value that only grows, false for a gauge
+       * @param read reads the value
+       */
+      static void addSampled(const std::string& name, const std::string& help, bool counter,
+        std::function<double()> read);
+
+      /**
+       * Exports the metrics in the Prometheus text exposition format
+       */
+      static std::string prometheus();
+
+      /**
+       * Exports the metrics as a JSON object, with percentiles instead of buckets
+       */
+      static std::string json();
+  };
+};
+#endif
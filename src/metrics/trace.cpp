@@ -0,0 +1,139 @@
+#include <metrics/trace.hpp>
+
+#include <cstring>
+
+#include <config.h>
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+#include <metrics/registry.hpp>
+
+bool metrics::Tracer::enabled = false;
+uint64_t metrics::Tracer::threshold = 0;
+std::function<void(const metrics::Trace&)> metrics::Tracer::reporter;
+
+/**
+ * The number of traces an event loop thread keeps, a power of two
+ */
+static const uint64_t SLOTS = 4096;
+
+/**
+ * The traces of the calling event loop thread and the generation of the next one
+ */
+static thread_local metrics::Trace* slots = NULL;
+static thread_local uint64_t generation = 0;
+
+void metrics::Tracer::configure(bool e, uint64_t t) {
+  enabled = e;
+  threshold = t;
+}
+
+void metrics::Tracer::setReporter(std::function<void(const Trace&)> r) {
+  reporter = r;
+}
+
+metrics::Trace* metrics::Tracer::begin(struct evhttp_request* req, uint64_t accepted, uint64_t received) {
+  if (!enabled) {
+    return NULL;
+  }
+
+  // the slots of a thread live as long as the process, like the thread
+  if (!slots) {
+    slots = new Trace[SLOTS];
+  }
+
+  uint64_t id = ++generation;
+  Trace* trace = &slots[id & (SLOTS - 1)];
+  trace->generation = id;
+
+  for (auto& stamp : trace->stamps) {
+    stamp.store(0, std::memory_order_relaxed);
+  }
+
+  trace->stamps[(int)Phase::ACCEPTED].store(accepted, std::memory_order_relaxed);
+  trace->stamps[(int)Phase::RECEIVED].store(received, std::memory_order_relaxed);
+  trace->status = 0;
+
+  strncpy(trace->method, evhttp_request_get_command(req) == EVHTTP_REQ_GET ? "GET" : "-", sizeof(trace->method));
+  strncpy(trace->uri, evhttp_request_get_uri(req), sizeof(trace->uri) - 1);
+  trace->uri[sizeof(trace->uri) - 1] = '\0';
+
+#ifdef HAVE_SYS_SDT_H
+  if (accepted) {
+    DTRACE_PROBE3(salthttpd, phase, id, (int)Phase::ACCEPTED, accepted);
+  }
+
+  DTRACE_PROBE3(salthttpd, phase, id, (int)Phase::RECEIVED, received);
+#endif
+
+  return trace;
+}
+
+void metrics::Tracer::mark(Trace* trace, Phase phase) {
+  if (!trace) {
+    return;
+  }
+
+  uint64_t now = now_us();
+  trace->stamps[(int)phase].store(now, std::memory_order_relaxed);
+
+#ifdef HAVE_SYS_SDT_H
+  DTRACE_PROBE3(salthttpd, phase, trace->generation, (int)phase, now);
+#endif
+}
+
+void metrics::Tracer::sent(Trace* trace, int status) {
+  if (!trace) {
+    return;
+  }
+
+  trace->status = status;
+  mark(trace, Phase::SENT);
+}
+
+/**
+ * Returns the time between two phases, 0 if either was not passed
+ */
+static uint64_t between(const metrics::Trace& trace, metrics::Phase from, metrics::Phase to) {
+  uint64_t a = trace.stamps[(int)from].load(std::memory_order_relaxed);
+  uint64_t b = trace.stamps[(int)to].load(std::memory_order_relaxed);
+  return a && b > a ? b - a : 0;
+}
+
+void metrics::Tracer::complete(uint64_t id) {
+  if (!id || !slots || slots[id & (SLOTS - 1)].generation != id) {
+    return;
+  }
+
+  Trace& trace = slots[id & (SLOTS - 1)];
+  mark(&trace, Phase::COMPLETED);
+
+  if (trace.stamps[(int)Phase::ACCEPTED].load(std::memory_order_relaxed)) {
+    Registry::record(Timer::READ, between(trace, Phase::ACCEPTED, Phase::RECEIVED));
+  }
+
+  // in reactor mode the request is handled as soon as it has been read
+  Phase started = trace.stamps[(int)Phase::DEQUEUED].load(std::memory_order_relaxed) ? Phase::DEQUEUED
+    : Phase::RECEIVED;
+
+  if (trace.stamps[(int)Phase::RESOLVED].load(std::memory_order_relaxed)) {
+    Registry::record(Timer::RESOLVE, between(trace, started, Phase::RESOLVED));
+    Registry::record(Timer::RESPOND, between(trace, Phase::RESOLVED, Phase::SENT));
+  }
+
+  uint64_t total = between(trace, Phase::RECEIVED, Phase::COMPLETED);
+  Registry::record(Timer::WRITE, between(trace, Phase::SENT, Phase::COMPLETED));
+  Registry::record(Timer::TOTAL, total);
+
+  if (threshold && total >= threshold) {
+#ifdef HAVE_SYS_SDT_H
+    DTRACE_PROBE2(salthttpd, slow, id, total);
+#endif
+
+    if (reporter) {
+      reporter(trace);
+    }
+  }
+}
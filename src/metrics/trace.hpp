@@ -0,0 +1,135 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+#include <event2/http.h>
+
+namespace metrics {
+  /**
+   * The points a request passes on its way through the server
+   */
+  enum class Phase {
+    /**
+     * The connection was accepted, only known for the first request on a connection
+     */
+    ACCEPTED,
+
+    /**
+     * The request has been read and parsed
+     */
+    RECEIVED,
+
+    /**
+     * The request was queued for a worker, and taken off the queue (pool mode)
+     */
+    ENQUEUED,
+    DEQUEUED,
+
+    /**
+     * The file has been looked up and opened, or found missing
+     */
+    RESOLVED,
+
+    /**
+     * The response was handed to the event loop, which starts writing it
+     */
+    SENT,
+
+    /**
+     * The response has been written out
+     */
+    COMPLETED,
+
+    COUNT
+  };
+
+  /**
+   * The timestamps of a request, in steady microseconds, 0 for phases it did not pass
+   */
+  struct Trace {
+    /**
+     * Tells the requests that used the same slot apart
+     */
+    uint64_t generation;
+
+    std::atomic<uint64_t> stamps[(int)Phase::COUNT];
+
+    int status;
+    char method[8];
+    char uri[256];
+  };
+
+  /**
+   * The Tracer takes timestamps of requests at every phase and, once a response has been
+   * written out, adds the time between them to the phase histograms of the Registry and
+   * reports requests slower than a threshold with their full breakdown.
+   *
+   * Traces live in a fixed ring of slots per event loop thread, so tracing never allocates;
+   * a request that is still in flight when its slot comes around again, or whose connection
+   * is lost, simply goes unreported. Workers stamp the trace of a request they handle, which
+   * the queue hands over to them along with the request.
+   *
+   * When built with sys/sdt.h, every phase also fires the salthttpd:phase USDT probe with
+   * the trace id, the phase and the timestamp, and slow requests fire salthttpd:slow.
+   */
+  class Tracer {
+    protected:
+      static bool enabled;
+
+      /**
+       * Requests taking longer than this many microseconds are reported, 0 reports none
+       */
+      static uint64_t threshold;
+
+      static std::function<void(const Trace&)> reporter;
+
+    public:
+      /**
+       * Configures tracing. Must be called before the event loops start.
+       * @param enabled false to trace nothing
+       * @param threshold the total time in microseconds above which requests are reported, 0 for none
+       */
+      static void configure(bool enabled, uint64_t threshold);
+
+      /**
+       * Sets the function slow requests are reported to, on the event loop thread
+       * @param reporter the reporter
+       */
+      static void setReporter(std::function<void(const Trace&)> reporter);
+
+      /**
+       * Starts the trace of a request. Must be called on the event loop that owns it.
+       * @param req the request
+       * @param accepted when its connection was accepted, 0 if unknown
+       * @param received when it was read
+       * @return the trace, or NULL if tracing is disabled
+       */
+      static Trace* begin(struct evhttp_request* req, uint64_t accepted, uint64_t received);
+
+      /**
+       * Stamps a phase of a request
+       * @param trace the trace, may be NULL
+       * @param phase the phase
+       */
+      static void mark(Trace* trace, Phase phase);
+
+      /**
+       * Stamps the response being handed to the event loop
+       * @param trace the trace, may be NULL
+       * @param status the status of the response
+       */
+      static void sent(Trace* trace, int status);
+
+      /**
+       * Ends the trace of a request once its response has been written out. The trace is
+       * told by its generation, which evhttp keeps along with the request, so that the
+       * completion of a request whose slot has been reused is ignored.
+       * @param generation the generation of the trace, 0 for none
+       */
+      static void complete(uint64_t generation);
+  };
+};
+#endif
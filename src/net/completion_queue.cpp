@@ -0,0 +1,45 @@
+#include <net/completion_queue.hpp>
+
+net::Completion::~Completion() {
+}
+
+net::CompletionQueue::CompletionQueue(struct event_base* base) : queue(), pending(false), wakeup(NULL) {
+  wakeup = event_new(base, -1, 0, drain_cb, this);
+
+  if (!wakeup) {
+    throw IOException("Failed to create completion event");
+  }
+}
+
+net::CompletionQueue::~CompletionQueue() {
+  event_free(wakeup);
+
+  Completion* c;
+  while ((c = queue.pop()) != nullptr) {
+    delete c;
+  }
+}
+
+void net::CompletionQueue::post(Completion* c) {
+  queue.push(c);
+
+  // only the first post after a drain has to wake the loop
+  if (!pending.exchange(true)) {
+    event_active(wakeup, 0, 0);
+  }
+}
+
+void net::CompletionQueue::drain() {
+  // cleared before draining, so a post racing with us wakes the loop again
+  pending.store(false);
+
+  Completion* c;
+  while ((c = queue.pop()) != nullptr) {
+    c->complete();
+    delete c;
+  }
+}
+
+void net::CompletionQueue::drain_cb(evutil_socket_t, short, void* arg) {
+  static_cast<CompletionQueue*>(arg)->drain();
+}
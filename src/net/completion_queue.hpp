@@ -0,0 +1,74 @@
+#ifndef COMPLETION_QUEUE_HPP
+#define COMPLETION_QUEUE_HPP
+
+#include <atomic>
+
+#include <event2/event.h>
+
+#include <concurrency/mpsc_queue.hpp>
+#include <exceptions.hpp>
+
+namespace net {
+  /**
+   * A unit of work that has to finish on an event loop thread, typically
+   * the send of a response that was prepared by a worker thread.
+   */
+  class Completion : public concurrency::MpscNode {
+    public:
+      virtual ~Completion();
+
+      /**
+       * Called on the event loop thread. The completion is deleted afterwards.
+       */
+      virtual void complete() = 0;
+  };
+
+  /**
+   * The CompletionQueue lets any thread hand completions back to an event loop.
+   * Completions are pushed onto a lock-free queue, and the loop is woken with
+   * event_active() and drains the queue on its own thread.
+   */
+  class CompletionQueue {
+    protected:
+      /**
+       * The queue of completions waiting for the loop
+       */
+      concurrency::MpscQueue<Completion> queue;
+
+      /**
+       * Whether or not the wakeup event has been activated and not yet handled
+       */
+      std::atomic<bool> pending;
+
+      /**
+       * The event used to wake the loop
+       */
+      struct event* wakeup;
+
+      /**
+       * Runs every queued completion
+       */
+      void drain();
+
+      static void drain_cb(evutil_socket_t, short, void*);
+
+    public:
+      /**
+       * Creates a completion queue drained by the event loop
+       * @param base the event loop
+       */
+      CompletionQueue(struct event_base* base);
+
+      /**
+       * Deletes any completion that has not been run
+       */
+      ~CompletionQueue();
+
+      /**
+       * Posts a completion to the event loop. Safe to call from any thread.
+       * @param c the completion, owned by the queue from now on
+       */
+      void post(Completion* c);
+  };
+};
+#endif
@@ -0,0 +1,253 @@
+#include <net/reactor.hpp>
+
+#include <sstream>
+#include <functional>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <metrics/registry.hpp>
+
+/**
+ * Accept times kept for connections that have not sent a request, before they are dropped
+ * as belonging to connections that never will
+ */
+static const size_t MAX_ACCEPTED = 65536;
+
+/**
+ * The reactor whose event loop runs on the calling thread
+ */
+static thread_local net::Reactor* running = NULL;
+
+/**
+ * Stops a reactor accepting, on its own thread
+ */
+class DrainCompletion : public net::Completion {
+  protected:
+    std::function<void()> fn;
+
+  public:
+    DrainCompletion(std::function<void()> f) : fn(f) {
+    }
+
+    void complete() {
+      fn();
+    }
+};
+
+net::Reactor::Reactor(int k) : id(k), cpu(-1), base(NULL), http(NULL), sockets(), completions(NULL), thread(),
+  accepted(), inflight(0), completed(0), aborted(0), draining(false) {
+  base = event_base_new();
+
+  if (!base) {
+    throw IOException("Failed to create event base.");
+  }
+
+  http = evhttp_new(base);
+
+  if (!http) {
+    event_base_free(base);
+    throw IOException("Failed to create http server");
+  }
+
+  completions = new CompletionQueue(base);
+}
+
+net::Reactor::~Reactor() {
+  join();
+
+  // drops completions that never made it back to the loop, before their requests are freed
+  delete completions;
+
+  // the bound socket owns the listener, and is freed along with the http server
+  evhttp_free(http);
+  event_base_free(base);
+}
+
+void net::Reactor::bind(const std::string& address, int port) {
+  std::stringstream ss;
+  ss << address << ":" << port;
+
+  struct sockaddr_storage addr;
+  int addrlen = sizeof(addr);
+
+  if (evutil_parse_sockaddr_port(ss.str().c_str(), (struct sockaddr*)&addr, &addrlen) == -1) {
+    throw IOException("Invalid listen address " + ss.str());
+  }
+
+  struct evconnlistener* listener = evconnlistener_new_bind(base, NULL, NULL,
+    LEV_OPT_REUSEABLE | LEV_OPT_REUSEABLE_PORT | LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC,
+    -1, (struct sockaddr*)&addr, addrlen);
+
+  if (!listener) {
+    throw IOException("Failed to bind to address.");
+  }
+
+  listen(listener);
+}
+
+void net::Reactor::adopt(int fd) {
+  // what evhttp_accept_socket_with_handle() does, except that accepted connections are
+  // closed on exec as well, so that they don't leak into the next upgrade
+  struct evconnlistener* listener = evconnlistener_new(base, NULL, NULL,
+    LEV_OPT_REUSEABLE | LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC, 0, fd);
+
+  if (!listener) {
+    close(fd);
+    throw IOException("Failed to listen on inherited socket.");
+  }
+
+  listen(listener);
+}
+
+void net::Reactor::listen(struct evconnlistener* listener) {
+  struct evhttp_bound_socket* socket = evhttp_bind_listener(http, listener);
+
+  if (!socket) {
+    evconnlistener_free(listener);
+    throw IOException("Failed to bind to address.");
+  }
+
+  sockets.push_back(socket);
+}
+
+std::vector<int> net::Reactor::getSockets() const {
+  std::vector<int> fds;
+
+  for (struct evhttp_bound_socket* socket : sockets) {
+    fds.push_back(evhttp_bound_socket_get_fd(socket));
+  }
+
+  return fds;
+}
+
+void net::Reactor::setCallback(void (*cb)(struct evhttp_request*, void*), void* arg) {
+  evhttp_set_gencb(http, cb, arg);
+}
+
+struct bufferevent* net::Reactor::accept_cb(struct event_base* base, void* arg) {
+  Reactor* reactor = static_cast<Reactor*>(arg);
+
+  // what evhttp creates by default, it sets the socket itself
+  struct bufferevent* bev = bufferevent_socket_new(base, -1, BEV_OPT_CLOSE_ON_FREE);
+
+  if (bev) {
+    if (reactor->accepted.size() >= MAX_ACCEPTED) {
+      reactor->accepted.clear();
+    }
+
+    reactor->accepted[bev] = metrics::now_us();
+  }
+
+  return bev;
+}
+
+void net::Reactor::trackAccepts() {
+  evhttp_set_bevcb(http, accept_cb, this);
+}
+
+uint64_t net::Reactor::acceptedAt(struct evhttp_request* req) {
+  if (accepted.empty()) {
+    return 0;
+  }
+
+  struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+
+  if (!evcon) {
+    return 0;
+  }
+
+  auto it = accepted.find(evhttp_connection_get_bufferevent(evcon));
+
+  if (it == accepted.end()) {
+    return 0;
+  }
+
+  uint64_t stamp = it->second;
+  accepted.erase(it);
+  return stamp;
+}
+
+void net::Reactor::begin(struct evhttp_request* req) {
+  struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+
+  if (!evcon) {
+    return;
+  }
+
+  inflight.store(inflight.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  evhttp_connection_set_closecb(evcon, close_cb, this);
+
+  if (draining.load(std::memory_order_relaxed)) {
+    evhttp_add_header(evhttp_request_get_output_headers(req), "Connection", "close");
+  }
+}
+
+void net::Reactor::finish(struct evhttp_request* req) {
+  struct evhttp_connection* evcon = evhttp_request_get_connection(req);
+
+  if (evcon) {
+    evhttp_connection_set_closecb(evcon, NULL, NULL);
+  }
+
+  inflight.store(inflight.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+  completed.store(completed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void net::Reactor::watch(struct evhttp_connection* evcon) {
+  evhttp_connection_set_closecb(evcon, close_cb, this);
+}
+
+void net::Reactor::abort(struct evhttp_connection* evcon) {
+  inflight.store(inflight.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+  aborted.store(aborted.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void net::Reactor::close_cb(struct evhttp_connection* evcon, void* arg) {
+  static_cast<Reactor*>(arg)->abort(evcon);
+}
+
+void net::Reactor::drain() {
+  post(new DrainCompletion([this] {
+    // the sockets own their listeners, which close the descriptors
+    for (struct evhttp_bound_socket* socket : sockets) {
+      evhttp_del_accept_socket(http, socket);
+    }
+
+    sockets.clear();
+    draining.store(true, std::memory_order_release);
+  }));
+}
+
+net::Reactor* net::Reactor::current() {
+  return running;
+}
+
+void net::Reactor::pin(int k) {
+  cpu = k;
+}
+
+void net::Reactor::start() {
+  thread = std::thread([this] {
+    if (cpu >= 0) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    running = this;
+    event_base_dispatch(base);
+  });
+}
+
+void net::Reactor::stop() {
+  event_base_loopbreak(base);
+}
+
+void net::Reactor::join() {
+  if (thread.joinable()) {
+    thread.join();
+  }
+}
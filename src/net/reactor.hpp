@@ -0,0 +1,282 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <string>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include <event2/event.h>
+#include <event2/http.h>
+#include <event2/listener.h>
+#include <event2/bufferevent.h>
+
+#include <exceptions.hpp>
+#include <net/completion_queue.hpp>
+
+namespace net {
+  /**
+   * A Reactor owns an event loop and a HTTP server bound to it. Every reactor binds its
+   * own listening socket with SO_REUSEPORT, so that several reactors can share the same
+   * address and let the kernel spread incoming connections between them.
+   *
+   * A reactor counts the requests it has read and not answered in full, so that it can
+   * be drained: it stops accepting, closes connections after their response instead of
+   * keeping them alive, and is done once the count is back to 0.
+   */
+  class Reactor {
+    protected:
+      /**
+       * The index of the reactor, used for naming and CPU pinning
+       */
+      int id;
+
+      /**
+       * The CPU the reactor thread is pinned to, or -1 if not pinned
+       */
+      int cpu;
+
+      /**
+       * The event loop of the reactor
+       */
+      struct event_base* base;
+
+      /**
+       * The HTTP server attached to the event loop
+       */
+      struct evhttp* http;
+
+      /**
+       * The listening sockets of the reactor
+       */
+      std::vector<struct evhttp_bound_socket*> sockets;
+
+      /**
+       * Completions posted back to this reactor by worker threads
+       */
+      CompletionQueue* completions;
+
+      /**
+       * The thread running the event loop
+       */
+      std::thread thread;
+
+      /**
+       * When the connections that have not sent a request yet were accepted, by their
+       * buffer event, only kept when tracing
+       */
+      std::unordered_map<struct bufferevent*, uint64_t> accepted;
+
+      /**
+       * Requests read and not yet answered in full. Only changed on the reactor thread.
+       */
+      std::atomic<uint64_t> inflight;
+
+      /**
+       * Requests answered in full, and requests whose connection was lost before. Only
+       * changed on the reactor thread.
+       */
+      std::atomic<uint64_t> completed;
+      std::atomic<uint64_t> aborted;
+
+      /**
+       * Whether the reactor has stopped accepting
+       */
+      std::atomic<bool> draining;
+
+      /**
+       * Creates the buffer event of an accepted connection and notes the time
+       */
+      static struct bufferevent* accept_cb(struct event_base* base, void* arg);
+
+      /**
+       * Called by evhttp when the connection of a request in flight goes away
+       */
+      static void close_cb(struct evhttp_connection* evcon, void* arg);
+
+      /**
+       * Adds a listening socket to the HTTP server
+       */
+      void listen(struct evconnlistener* listener);
+
+    public:
+      /**
+       * Creates a new reactor with its own event loop and HTTP server
+       * @param id the index of the reactor
+       */
+      Reactor(int id);
+
+      /**
+       * Frees the HTTP server, the listening socket and the event loop
+       */
+      ~Reactor();
+
+      /**
+       * Binds a listening socket with SO_REUSEPORT to the address and port
+       * @param address the address to bind to
+       * @param port the port to listen on
+       */
+      void bind(const std::string& address, int port);
+
+      /**
+       * Listens on a socket that is already bound, such as one handed down by the process
+       * this one replaces
+       * @param fd the listening socket, owned by the reactor from now on
+       */
+      void adopt(int fd);
+
+      /**
+       * Returns the listening sockets of the reactor
+       * @return the socket descriptors
+       */
+      std::vector<int> getSockets() const;
+
+      /**
+       * Sets the callback that is invoked for every request accepted by this reactor
+       * @param cb the request callback
+       * @param arg the argument passed to the callback
+       */
+      void setCallback(void (*cb)(struct evhttp_request*, void*), void* arg);
+
+      /**
+       * Notes when connections are accepted, for tracing
+       */
+      void trackAccepts();
+
+      /**
+       * Returns when the connection of a request was accepted, if it is the first request
+       * on the connection. Must be called on the reactor thread.
+       * @param req the request
+       * @return the steady time in microseconds, or 0 if unknown
+       */
+      uint64_t acceptedAt(struct evhttp_request* req);
+
+      /**
+       * Counts a request as in flight until finish() is called for it, or its connection
+       * is lost. Must be called on the reactor thread.
+       * @param req the request
+       */
+      void begin(struct evhttp_request* req);
+
+      /**
+       * Counts a request as answered, once its response has been written out
+       * @param req the request
+       */
+      void finish(struct evhttp_request* req);
+
+      /**
+       * Takes the close callback of a connection with a request in flight back from a
+       * response that had taken it over, once that response is complete
+       * @param evcon the connection
+       */
+      void watch(struct evhttp_connection* evcon);
+
+      /**
+       * Counts the request in flight on a connection as lost. Called when a response
+       * that has taken the close callback of the connection over is abandoned.
+       * @param evcon the connection
+       */
+      void abort(struct evhttp_connection* evcon);
+
+      /**
+       * Stops accepting connections and keeping them alive. Safe to call from any thread.
+       */
+      void drain();
+
+      /**
+       * Returns the number of requests in flight. Safe to call from any thread.
+       * @return the number of requests
+       */
+      uint64_t getInflight() const {
+        return inflight.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Returns the number of requests answered in full. Safe to call from any thread.
+       * @return the number of requests
+       */
+      uint64_t getCompleted() const {
+        return completed.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Returns the number of requests whose connection was lost before they were answered
+       * in full. Safe to call from any thread.
+       * @return the number of requests
+       */
+      uint64_t getAborted() const {
+        return aborted.load(std::memory_order_relaxed);
+      }
+
+      /**
+       * Returns whether the reactor has stopped accepting and answered every request.
+       * Safe to call from any thread.
+       * @return true once drained
+       */
+      bool isDrained() const {
+        return draining.load(std::memory_order_acquire) && getInflight() == 0;
+      }
+
+      /**
+       * Returns the reactor running on the calling thread
+       * @return the reactor, or NULL if the thread does not run one
+       */
+      static Reactor* current();
+
+      /**
+       * Pins the reactor thread to a CPU when it is started
+       * @param cpu the CPU index
+       */
+      void pin(int cpu);
+
+      /**
+       * Starts the event loop on a new thread
+       */
+      void start();
+
+      /**
+       * Breaks the event loop. Safe to call from any thread.
+       */
+      void stop();
+
+      /**
+       * Waits for the event loop thread to exit
+       */
+      void join();
+
+      /**
+       * Returns the index of the reactor
+       * @return the reactor index
+       */
+      int getId() {
+        return id;
+      }
+
+      /**
+       * Returns the event loop of the reactor
+       * @return the event base
+       */
+      struct event_base* getBase() {
+        return base;
+      }
+
+      /**
+       * Returns the HTTP server of the reactor
+       * @return the evhttp instance
+       */
+      struct evhttp* getHttp() {
+        return http;
+      }
+
+      /**
+       * Posts a completion to be run on the reactor thread. Safe to call from any thread.
+       * @param c the completion
+       */
+      void post(Completion* c) {
+        completions->post(c);
+      }
+  };
+};
+#endif
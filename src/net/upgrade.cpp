@@ -0,0 +1,132 @@
+#include <net/upgrade.hpp>
+
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+extern char** environ;
+
+static const char LISTEN_FDS[] = "SALTHTTPD_LISTEN_FDS";
+static const char READY_FD[] = "SALTHTTPD_READY_FD";
+
+/**
+ * The pipe to the process that started this one, -1 if there is none
+ */
+static int ready_fd = -1;
+
+/**
+ * Parses a descriptor number and makes sure it is open, and closed on exec from now on
+ */
+static int take(const char* value) {
+  char* end = NULL;
+  long fd = strtol(value, &end, 10);
+
+  if (end == value || *end != '\0' || fd < 0 || fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+    return -1;
+  }
+
+  return (int)fd;
+}
+
+std::vector<int> net::Upgrade::inherited() {
+  std::vector<int> sockets;
+  const char* listen = getenv(LISTEN_FDS);
+  const char* ready = getenv(READY_FD);
+
+  if (listen) {
+    std::string list(listen);
+    size_t start = 0;
+
+    while (start < list.size()) {
+      size_t comma = list.find(',', start);
+      std::string item = list.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+      int fd = take(item.c_str());
+
+      if (fd >= 0) {
+        sockets.push_back(fd);
+      }
+
+      start = comma == std::string::npos ? list.size() : comma + 1;
+    }
+  }
+
+  if (ready) {
+    ready_fd = take(ready);
+  }
+
+  // a process this one starts in turn gets sockets of its own
+  unsetenv(LISTEN_FDS);
+  unsetenv(READY_FD);
+
+  return sockets;
+}
+
+pid_t net::Upgrade::spawn(char** argv, const std::vector<int>& sockets, int* ready) {
+  int fds[2];
+
+  if (pipe2(fds, O_CLOEXEC) == -1) {
+    throw IOException(errno, std::string("Failed to create pipe: ") + strerror(errno));
+  }
+
+  std::string listen = std::string(LISTEN_FDS) + "=";
+
+  for (size_t i = 0; i < sockets.size(); i++) {
+    listen += (i > 0 ? "," : "") + std::to_string(sockets[i]);
+  }
+
+  std::string notify = std::string(READY_FD) + "=" + std::to_string(fds[1]);
+
+  // everything the child needs is prepared up front, as a fork of a threaded process may
+  // only make async-signal-safe calls before exec
+  std::vector<char*> env;
+
+  for (char** e = environ; *e; e++) {
+    if (strncmp(*e, LISTEN_FDS, sizeof(LISTEN_FDS) - 1) != 0 && strncmp(*e, READY_FD, sizeof(READY_FD) - 1) != 0) {
+      env.push_back(*e);
+    }
+  }
+
+  env.push_back(&listen[0]);
+  env.push_back(&notify[0]);
+  env.push_back(NULL);
+
+  pid_t pid = fork();
+
+  if (pid == -1) {
+    close(fds[0]);
+    close(fds[1]);
+    throw IOException(errno, std::string("Failed to fork: ") + strerror(errno));
+  }
+
+  if (pid == 0) {
+    for (size_t i = 0; i < sockets.size(); i++) {
+      fcntl(sockets[i], F_SETFD, 0);
+    }
+
+    fcntl(fds[1], F_SETFD, 0);
+    execvpe(argv[0], argv, &env[0]);
+    _exit(127);
+  }
+
+  close(fds[1]);
+  *ready = fds[0];
+  return pid;
+}
+
+void net::Upgrade::ready() {
+  if (ready_fd == -1) {
+    return;
+  }
+
+  char byte = 1;
+
+  while (write(ready_fd, &byte, 1) == -1 && errno == EINTR) {
+  }
+
+  close(ready_fd);
+  ready_fd = -1;
+}
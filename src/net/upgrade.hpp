@@ -0,0 +1,47 @@
+#ifndef UPGRADE_HPP
+#define UPGRADE_HPP
+
+#include <vector>
+
+#include <sys/types.h>
+
+#include <exceptions.hpp>
+
+namespace net {
+  /**
+   * Replaces a running server with a new binary without closing its listening sockets.
+   *
+   * The running server starts the binary at its command line again, with its listening
+   * sockets left open across exec() and their numbers in SALTHTTPD_LISTEN_FDS. The new
+   * process listens on those sockets instead of binding its own, so connections keep
+   * being accepted throughout, and writes a byte to the pipe in SALTHTTPD_READY_FD once
+   * its event loops run. Only then does the old process stop accepting and finish the
+   * requests it has.
+   */
+  class Upgrade {
+    public:
+      /**
+       * Takes the listening sockets handed down by the process that started this one.
+       * Must be called once, before any thread is started.
+       * @return the sockets, empty if there are none
+       */
+      static std::vector<int> inherited();
+
+      /**
+       * Starts the new binary with the listening sockets
+       * @param argv the command line to run, argv[0] being looked up like a shell does
+       * @param sockets the listening sockets
+       * @param ready set to a pipe that becomes readable once the new process serves, or
+       *              closes if it fails to
+       * @return the process id of the new process
+       * @throw IOException if the process can't be started
+       */
+      static pid_t spawn(char** argv, const std::vector<int>& sockets, int* ready);
+
+      /**
+       * Tells the process that started this one that it serves, if any did
+       */
+      static void ready();
+  };
+};
+#endif
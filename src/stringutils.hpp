@@ -2,10 +2,40 @@
 #define STRING_UTILS_HPP
 
 #include <string>
+#include <cstring>
 #include <algorithm>
 #include <ioutils.hpp>
 
 namespace string {
+  /**
+   * A run of characters owned by someone else, like std::string_view. Taking
+   * one apart never allocates, so hot paths use slices instead of substrings.
+   */
+  struct slice {
+    const char* data;
+    size_t size;
+
+    slice(const char* d, size_t n) : data(d), size(n) {
+    }
+
+    slice(const char* s) : data(s), size(strlen(s)) {
+    }
+
+    slice(const std::string& s) : data(s.data()), size(s.size()) {
+    }
+
+    /**
+     * Copies the characters into a string
+     */
+    std::string str() const {
+      return std::string(data, size);
+    }
+
+    bool operator==(const slice& other) const {
+      return size == other.size && memcmp(data, other.data, size) == 0;
+    }
+  };
+
   /**
    * String utility class.
    */
@@ -33,16 +63,36 @@ namespace string {
        * @return the chopped string
        */
       static std::string chop(const std::string &t, const std::string &ws) {
-        std::string str = t;
-        size_t found = str.find_last_not_of(ws);
+        return chopped(t, ws.c_str()).str();
+      }
 
-        if (found != std::string::npos) {
-          str.erase(found + 1);
-        } else {
-          str.clear();
+      /**
+       * Chops away the specified characters from the end of a slice, without copying
+       * @param t the slice to chop
+       * @param ws the characters to remove
+       * @return the chopped slice
+       */
+      static slice chopped(slice t, const char* ws) {
+        while (t.size > 0 && t.data[t.size - 1] && strchr(ws, t.data[t.size - 1])) {
+          t.size--;
+        }
+
+        return t;
+      }
+
+      /**
+       * Removes the specified characters from both ends of a slice, without copying
+       * @param t the slice to trim
+       * @param ws the characters to remove
+       * @return the trimmed slice
+       */
+      static slice trimmed(slice t, const char* ws) {
+        while (t.size > 0 && t.data[0] && strchr(ws, t.data[0])) {
+          t.data++;
+          t.size--;
         }
 
-        return str;
+        return chopped(t, ws);
       }
   };
 };
@@ -0,0 +1,115 @@
+#!/bin/bash
+#
+# Checks that the server survives clients that go away while their request waits for a
+# worker (pool mode). A single worker is kept busy reading files into the content cache
+# while clients ask for files that are streamed, or compressed on the fly, and close
+# their connection before the worker gets to them.
+#
+# usage: disconnect.sh [-n clients] [-p port]
+#
+# The binary is taken from the build directory next to this script, or from $SALTHTTPD.
+
+set -e
+
+dir=$(cd "$(dirname "$0")" && pwd)
+server=${SALTHTTPD:-$dir/../salthttpd}
+clients=50
+port=${PORT:-18182}
+
+while getopts "n:p:h" opt; do
+  case $opt in
+    n) clients=$OPTARG ;;
+    p) port=$OPTARG ;;
+    *) sed -n '3,10p' "$0" | sed 's/^# \{0,1\}//'; exit 1 ;;
+  esac
+done
+
+if [ ! -x "$server" ]; then
+  echo "$server not found, run make first" >&2
+  exit 1
+fi
+
+fixture=$(mktemp -d)
+server_pid=""
+
+cleanup() {
+  [ -n "$server_pid" ] && kill "$server_pid" 2>/dev/null && wait "$server_pid" 2>/dev/null
+  rm -rf "$fixture"
+}
+trap cleanup EXIT
+
+# files the worker takes a while to read into the cache, and files too large for it
+mkdir -p "$fixture/htdocs" "$fixture/errors"
+cp "$dir/../../errors/"*.html "$fixture/errors/"
+
+for i in $(seq 1 8); do
+  head -c $(( 8 * 1024 * 1024 )) /dev/urandom > "$fixture/htdocs/slow$i.bin"
+done
+
+head -c $(( 12 * 1024 * 1024 )) /dev/urandom > "$fixture/htdocs/large.bin"
+head -c $(( 9 * 1024 * 1024 )) /dev/urandom | base64 > "$fixture/htdocs/large.txt"
+
+cat > "$fixture/config" <<CONFIG
+server.mode = "pool"
+server.workers = "1"
+stream.threshold = "1"
+cache.max_bytes = "134217728"
+cache.max_file_size = "10485760"
+compress.enabled = "true"
+CONFIG
+
+"$server" -p "$port" -d "$fixture/htdocs" -e "$fixture/errors" -c "$fixture/config" > "$fixture/server.log" 2>&1 &
+server_pid=$!
+
+for i in $(seq 1 50); do
+  if (exec 3<>/dev/tcp/127.0.0.1/$port) 2>/dev/null; then
+    break
+  fi
+  sleep 0.1
+done
+
+# asks for a path and stays connected for a while
+hold() {
+  exec 3<>/dev/tcp/127.0.0.1/$port || return 0
+  printf "GET $1 HTTP/1.1\r\nHost: localhost\r\n\r\n" >&3 || true
+  sleep 2
+}
+
+# asks for a path and goes away; the start of a second request makes evhttp read, and
+# so see the connection close, while the first one still waits for the worker
+abandon() {
+  exec 3<>/dev/tcp/127.0.0.1/$port || return 0
+  printf "GET $1 HTTP/1.1\r\nHost: localhost\r\n$2\r\n" >&3 || true
+  sleep 0.01
+  printf "GET /" >&3 || true
+  exec 3>&-
+}
+
+# the clients are waited for by their ids, a plain wait would wait for the server as well
+pids=()
+
+for i in $(seq 1 8); do
+  hold "/slow$i.bin" &
+  pids+=($!)
+done
+
+sleep 0.1
+
+for i in $(seq 1 "$clients"); do
+  abandon /large.bin "" &
+  pids+=($!)
+  abandon /large.txt "Accept-Encoding: gzip\r\n" &
+  pids+=($!)
+done
+
+wait "${pids[@]}"
+
+status=$(curl -s -o /dev/null -w "%{http_code}" "http://127.0.0.1:$port/large.bin" || true)
+
+if ! kill -0 "$server_pid" 2>/dev/null || [ "$status" != 200 ]; then
+  echo "salthttpd did not survive clients going away (status $status):" >&2
+  cat "$fixture/server.log" >&2
+  exit 1
+fi
+
+echo "salthttpd survived $(( clients * 2 )) clients going away"